@@ -0,0 +1,52 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_cat.h"
+#include "harness/runner.h"
+
+ABSL_FLAG(std::string, scenario, "test-mem-leak-write-concurrent",
+          "Base binary name to compare; each allocator runs <scenario>_<allocator>.");
+ABSL_FLAG(std::vector<std::string>, allocators,
+          std::vector<std::string>({"glibc", "jemalloc", "tcmalloc", "mimalloc"}),
+          "Allocators to run; glibc selects the unsuffixed binary.");
+ABSL_FLAG(bool, verbose, false, "Echo the output of every run.");
+
+int main(int argc, char* argv[]) {
+    // Positional arguments (everything after "--") are forwarded to each run.
+    std::vector<char*> positional = absl::ParseCommandLine(argc, argv);
+    std::vector<std::string> forwarded(positional.begin() + 1, positional.end());
+
+    const std::string scenario = absl::GetFlag(FLAGS_scenario);
+    std::vector<std::pair<std::string, mem_harness::BinaryRun>> results;
+    for (const std::string& allocator : absl::GetFlag(FLAGS_allocators)) {
+        // bazel run starts in the runfiles tree, next to the data binaries.
+        std::string binary = allocator == "glibc" ? absl::StrCat("./", scenario)
+                                                  : absl::StrCat("./", scenario, "_", allocator);
+        std::cout << "Running " << binary << "..." << std::endl;
+        std::string echo_prefix = absl::GetFlag(FLAGS_verbose) ? "[" + allocator + "] " : "";
+        results.emplace_back(allocator, mem_harness::run_binary(binary, forwarded, echo_prefix));
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Scenario: " << scenario << std::endl;
+    std::cout << std::left << std::setw(12) << "Allocator" << std::right
+              << std::setw(18) << "Steady RSS (MB)" << std::setw(17) << "Final RSS (MB)"
+              << std::setw(16) << "Peak RSS (MB)" << std::setw(12) << "Wall (s)"
+              << "  Status" << std::endl;
+    bool ok = true;
+    for (const auto& [allocator, r] : results) {
+        ok = ok && r.ok;
+        std::cout << std::left << std::setw(12) << allocator << std::right
+                  << std::setw(18) << r.steady_rss_kb / 1024.0
+                  << std::setw(17) << r.final_rss_kb / 1024.0
+                  << std::setw(16) << r.peak_rss_kb / 1024.0
+                  << std::setw(12) << r.wall_s
+                  << "  " << (r.ok ? "ok" : "FAILED") << std::endl;
+    }
+    return ok ? 0 : 1;
+}
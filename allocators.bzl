@@ -0,0 +1,42 @@
+"""Allocator build variants for the test-mem-leak binaries."""
+
+# Allocator name -> cc_library passed as the cc_binary `malloc` attribute.
+# The default (unsuffixed) target keeps glibc malloc.
+ALLOCATORS = {
+    "jemalloc": "//:jemalloc",
+    "tcmalloc": "//:tcmalloc",
+    "mimalloc": "//:mimalloc",
+}
+
+def mem_leak_binary(name, deps = [], tags = [], **kwargs):
+    """Declares `name` plus one `name_<allocator>` cc_binary per allocator.
+
+    Each of those also gets a `_heapcount` twin linked with the malloc/new
+    interposers that --heap_counters needs. The variants are tagged manual so
+    `bazel build //...` does not build every allocator; build one by name, or
+    through a target that lists it in `data` (and is tagged manual itself).
+    """
+    native.cc_binary(name = name, deps = deps, tags = tags, **kwargs)
+    native.cc_binary(
+        name = name + "_heapcount",
+        deps = deps + ["//:heap_interpose"],
+        tags = tags + ["manual"],
+        **kwargs
+    )
+    for allocator, malloc in ALLOCATORS.items():
+        for suffix, extra_deps in [("", []), ("_heapcount", ["//:heap_interpose"])]:
+            native.cc_binary(
+                name = name + "_" + allocator + suffix,
+                malloc = malloc,
+                deps = deps + extra_deps,
+                tags = tags + ["manual"],
+                **kwargs
+            )
+
+def allocator_variants(names):
+    """Returns every allocator variant label of the given binaries, glibc first."""
+    return [":" + n for n in names] + [
+        ":" + n + "_" + allocator
+        for n in names
+        for allocator in ALLOCATORS.keys()
+    ]
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "absl/base/config.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_cat.h"
+#include "harness/runner.h"
+
+// --- Configuration ---
+
+ABSL_FLAG(std::vector<std::string>, scenarios,
+          std::vector<std::string>({"read", "write", "write_concurrent", "channel_churn", "rpc"}),
+          "Scenarios to run, in order.");
+ABSL_FLAG(std::string, baseline, "benchmark_baseline.txt",
+          "Baseline file; relative paths resolve against the directory bazel run was "
+          "invoked from.");
+ABSL_FLAG(bool, update_baseline, false,
+          "Write this run's results to --baseline instead of comparing against it.");
+ABSL_FLAG(int32_t, repetitions, 3, "Runs per scenario; every metric takes the median.");
+ABSL_FLAG(uint64_t, suite_seed, 1,
+          "Seed passed as --seed to the harness scenarios (Poisson arrivals).");
+ABSL_FLAG(double, rss_tolerance_pct, 10, "Allowed RSS growth over the baseline, in percent.");
+ABSL_FLAG(int64_t, rss_tolerance_kb, 2048,
+          "Allowed RSS growth in KB when larger than the percentage (absorbs noise "
+          "in small scenarios).");
+ABSL_FLAG(double, latency_tolerance_pct, 25,
+          "Allowed mean iteration latency growth over the baseline, in percent.");
+ABSL_FLAG(double, latency_tolerance_ms, 0.1,
+          "Allowed latency growth in ms when larger than the percentage.");
+ABSL_FLAG(bool, verbose, false, "Echo the output of every run.");
+
+/**
+ * @brief One suite entry: a binary and the fixed arguments it runs with.
+ */
+struct Scenario {
+    std::string name;
+    std::string binary;
+    std::vector<std::string> args;
+    // Harness binaries also get the open-loop Poisson schedule with --suite_seed.
+    bool harness = true;
+};
+
+/**
+ * @brief The suite. Sizes are kept small so the whole suite runs in well
+ * under a minute; change them only together with the baseline.
+ */
+std::vector<Scenario> suite_scenarios() {
+    return {
+        {"read", "test-mem-leak-read",
+         {"--iterations=30", "--read_size_kb=8192", "--file_size_kb=8192"}},
+        {"write", "test-mem-leak-write", {"--iterations=30", "--write_size_kb=8192"}},
+        {"write_concurrent", "test-mem-leak-write-concurrent",
+         {"--iterations=30", "--write_size_kb=4096", "--processes=4", "--threads_per_process=2"}},
+        {"channel_churn", "channel-churn",
+         {"--threads=2", "--channels_per_thread=500", "--live_channels=200"},
+         /*harness=*/false},
+        {"rpc", "test-mem-leak-write",
+         {"--iterations=30", "--write_size_kb=64", "--rpc", "--rpc_per_iteration=50"}},
+    };
+}
+
+/**
+ * @brief Metric name -> value for one scenario, e.g. "steady_rss_kb".
+ */
+using Metrics = std::map<std::string, double>;
+
+/**
+ * @brief Scenario name -> metrics, in a stable order.
+ */
+using SuiteResults = std::map<std::string, Metrics>;
+
+bool is_rss_metric(const std::string& metric) {
+    return metric.size() > 7 && metric.compare(metric.size() - 7, 7, "_rss_kb") == 0;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+/**
+ * @brief Runs scenario --repetitions times and takes the median of each metric.
+ * @return false if any run failed.
+ */
+bool run_scenario(const Scenario& scenario, Metrics* metrics) {
+    // bazel run starts in the runfiles tree, next to the data binaries. The
+    // suite runs the glibc builds only; allocator-compare covers the others.
+    const std::string binary = absl::StrCat("./", scenario.binary);
+    std::vector<std::string> args = scenario.args;
+    if (scenario.harness) {
+        args.push_back("--load=poisson");
+        args.push_back("--rate=50");
+        args.push_back(absl::StrCat("--seed=", absl::GetFlag(FLAGS_suite_seed)));
+    }
+
+    std::map<std::string, std::vector<double>> samples;
+    bool ok = true;
+    const int repetitions = std::max(1, absl::GetFlag(FLAGS_repetitions));
+    for (int r = 0; r < repetitions; ++r) {
+        std::cout << "Running " << scenario.name << " (" << r + 1 << "/" << repetitions << ")..."
+                  << std::endl;
+        mem_harness::BinaryRun run = mem_harness::run_binary(
+            binary, args, absl::GetFlag(FLAGS_verbose) ? "[" + scenario.name + "] " : "");
+        if (!run.ok) {
+            std::cerr << "Error: " << binary << " failed." << std::endl;
+            ok = false;
+            continue;
+        }
+        samples["steady_rss_kb"].push_back(run.steady_rss_kb);
+        samples["final_rss_kb"].push_back(run.final_rss_kb);
+        samples["peak_rss_kb"].push_back(run.peak_rss_kb);
+        samples["mean_iteration_ms"].push_back(run.mean_iteration_ms);
+    }
+    for (const auto& [metric, values] : samples) {
+        (*metrics)[metric] = median(values);
+    }
+    return ok;
+}
+
+/**
+ * @brief --baseline, resolved against BUILD_WORKING_DIRECTORY under bazel run.
+ */
+std::string baseline_path() {
+    std::string path = absl::GetFlag(FLAGS_baseline);
+    const char* workspace = std::getenv("BUILD_WORKING_DIRECTORY");
+    if (!path.empty() && path[0] != '/' && workspace != nullptr) {
+        path = absl::StrCat(workspace, "/", path);
+    }
+    return path;
+}
+
+/**
+ * @brief Versions the baseline was taken with; a bump shows up in the diff header.
+ */
+std::string build_description() {
+#ifdef ABSL_LTS_RELEASE_VERSION
+    const std::string abseil = absl::StrCat(ABSL_LTS_RELEASE_VERSION);
+#else
+    const std::string abseil = "head";
+#endif
+    return absl::StrCat("grpc ", grpc::Version(), ", abseil ", abseil, ", seed ",
+                        absl::GetFlag(FLAGS_suite_seed));
+}
+
+/**
+ * @brief Writes results as "<scenario> <metric> <value>" lines after a
+ * "#" comment naming the build.
+ */
+bool write_baseline(const std::string& path, const SuiteResults& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot write baseline " << path << std::endl;
+        return false;
+    }
+    out << "# benchmark-suite baseline: " << build_description() << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [scenario, metrics] : results) {
+        for (const auto& [metric, value] : metrics) {
+            out << scenario << " " << metric << " " << value << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Reads a file written by write_baseline(); *header gets its comment.
+ */
+bool read_baseline(const std::string& path, SuiteResults* results, std::string* header) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            if (header->empty() && !line.empty()) {
+                *header = line.substr(1);
+            }
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string scenario, metric;
+        double value = 0;
+        if (fields >> scenario >> metric >> value) {
+            (*results)[scenario][metric] = value;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Prints current against baseline per metric.
+ * @return false if any metric grew past its tolerance band.
+ */
+bool compare(const SuiteResults& baseline, const SuiteResults& current) {
+    const double rss_pct = absl::GetFlag(FLAGS_rss_tolerance_pct);
+    const double rss_kb = absl::GetFlag(FLAGS_rss_tolerance_kb);
+    const double latency_pct = absl::GetFlag(FLAGS_latency_tolerance_pct);
+    const double latency_ms = absl::GetFlag(FLAGS_latency_tolerance_ms);
+
+    std::cout << std::left << std::setw(18) << "Scenario" << std::setw(20) << "Metric"
+              << std::right << std::setw(14) << "Baseline" << std::setw(14) << "Current"
+              << std::setw(11) << "Change" << std::setw(13) << "Tolerance" << "  Status"
+              << std::endl;
+    bool ok = true;
+    for (const auto& [scenario, metrics] : current) {
+        for (const auto& [metric, value] : metrics) {
+            std::cout << std::left << std::setw(18) << scenario << std::setw(20) << metric
+                      << std::right;
+            auto s = baseline.find(scenario);
+            if (s == baseline.end() || s->second.count(metric) == 0) {
+                std::cout << std::setw(14) << "-" << std::setw(14) << value << "  new"
+                          << std::endl;
+                continue;
+            }
+            const double base = s->second.at(metric);
+            const double tolerance = is_rss_metric(metric)
+                                         ? std::max(base * rss_pct / 100, rss_kb)
+                                         : std::max(base * latency_pct / 100, latency_ms);
+            const char* status = "ok";
+            if (value > base + tolerance) {
+                status = "REGRESSED";
+                ok = false;
+            } else if (value < base - tolerance) {
+                status = "improved";
+            }
+            std::ostringstream change;
+            change << std::fixed << std::setprecision(1) << std::showpos
+                   << (base != 0 ? (value - base) * 100 / base : 0.0) << "%";
+            std::cout << std::setw(14) << base << std::setw(14) << value << std::setw(11)
+                      << change.str() << std::setw(13) << tolerance << "  " << status
+                      << std::endl;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    absl::ParseCommandLine(argc, argv);
+    std::cout << std::fixed << std::setprecision(2);
+
+    std::vector<Scenario> scenarios;
+    for (const std::string& name : absl::GetFlag(FLAGS_scenarios)) {
+        bool found = false;
+        for (const Scenario& scenario : suite_scenarios()) {
+            if (scenario.name == name) {
+                scenarios.push_back(scenario);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Warning: unknown scenario '" << name << "', skipped." << std::endl;
+        }
+    }
+
+    SuiteResults results;
+    bool ok = true;
+    for (const Scenario& scenario : scenarios) {
+        ok = run_scenario(scenario, &results[scenario.name]) && ok;
+    }
+
+    const std::string path = baseline_path();
+    std::cout << "Build: " << build_description() << std::endl;
+    if (absl::GetFlag(FLAGS_update_baseline)) {
+        if (!ok) {
+            std::cerr << "Error: not updating the baseline after failed runs." << std::endl;
+            return 1;
+        }
+        if (!write_baseline(path, results)) {
+            return 1;
+        }
+        std::cout << "Baseline written to " << path << std::endl;
+        return 0;
+    }
+
+    SuiteResults baseline;
+    std::string header;
+    if (!read_baseline(path, &baseline, &header)) {
+        std::cerr << "Warning: no baseline at " << path
+                  << "; run with --update_baseline to record one." << std::endl;
+    } else {
+        std::cout << "Baseline:" << header << std::endl;
+    }
+    ok = compare(baseline, results) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/security/credentials.h>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "harness/flags.h"
+#include "harness/histogram.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+
+// --- Configuration ---
+
+ABSL_FLAG(int32_t, threads, 4, "Threads creating and destroying channels concurrently.");
+ABSL_FLAG(int32_t, channels_per_thread, 2000, "Create/destroy cycles per thread.");
+ABSL_FLAG(int32_t, live_channels, 1000,
+          "Channels held open at once when measuring RSS per live channel.");
+ABSL_FLAG(bool, distinct_targets, true,
+          "Give every channel its own localhost port (as the repro loops do) "
+          "instead of one shared target.");
+
+/**
+ * @brief Target for the i-th channel; nothing listens there.
+ */
+std::string target_for(int64_t i) {
+    if (!absl::GetFlag(FLAGS_distinct_targets)) {
+        return "localhost:4000";
+    }
+    return "localhost:" + std::to_string(4000 + i % 60000);
+}
+
+struct ChurnStats {
+    mem_harness::LatencyHistogram create;
+    mem_harness::LatencyHistogram destroy;
+};
+
+/**
+ * @brief Creates and drops channels back to back, timing each half.
+ */
+void churn_thread(int thread_id, int count, ChurnStats* stats) {
+    for (int i = 0; i < count; ++i) {
+        int64_t start = mem_harness::now_ns();
+        auto creds = grpc::InsecureChannelCredentials();
+        auto channel = grpc::CreateChannel(target_for(int64_t{thread_id} * count + i), creds);
+        int64_t created = mem_harness::now_ns();
+        channel.reset();
+        creds.reset();
+        int64_t destroyed = mem_harness::now_ns();
+        stats->create.record(created - start);
+        stats->destroy.record(destroyed - created);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    absl::ParseCommandLine(argc, argv);
+    mem_harness::apply_process_flags();
+    std::cout << std::fixed << std::setprecision(2);
+
+    const int num_threads = std::max(1, absl::GetFlag(FLAGS_threads));
+    const int per_thread = absl::GetFlag(FLAGS_channels_per_thread);
+
+    // Pay for gRPC initialization before any measurement.
+    grpc::CreateChannel(target_for(0), grpc::InsecureChannelCredentials());
+
+    long initial_rss = mem_harness::get_current_rss_kb();
+    std::cout << "Initial RSS: " << initial_rss / 1024.0 << " MB" << std::endl;
+
+    // --- 1. Churn throughput ---
+    std::vector<ChurnStats> stats(num_threads);
+    std::vector<std::thread> threads;
+    int64_t start = mem_harness::now_ns();
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(churn_thread, t, per_thread, &stats[t]);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double elapsed_s = (mem_harness::now_ns() - start) / 1e9;
+
+    ChurnStats total;
+    for (const ChurnStats& s : stats) {
+        total.create.merge(s.create);
+        total.destroy.merge(s.destroy);
+    }
+    long after_churn_rss = mem_harness::get_current_rss_kb();
+    std::cout << "Churn: " << total.create.count() << " channels on " << num_threads
+              << " threads in " << elapsed_s << " s = " << total.create.count() / elapsed_s
+              << " channels/s" << std::endl;
+    std::cout << "  Create:  " << mem_harness::format_percentiles(total.create) << std::endl;
+    std::cout << "  Destroy: " << mem_harness::format_percentiles(total.destroy) << std::endl;
+    std::cout << "  RSS after churn: " << after_churn_rss / 1024.0 << " MB ("
+              << std::showpos << (after_churn_rss - initial_rss) / 1024.0 << std::noshowpos
+              << " MB)" << std::endl;
+
+    // --- 2. RSS per live channel ---
+    const int live = std::max(1, absl::GetFlag(FLAGS_live_channels));
+    auto creds = grpc::InsecureChannelCredentials();
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+    channels.reserve(live);
+    long before_live_rss = mem_harness::get_current_rss_kb();
+    for (int i = 0; i < live; ++i) {
+        channels.push_back(grpc::CreateChannel(target_for(i), creds));
+    }
+    long live_rss = mem_harness::get_current_rss_kb();
+    channels.clear();
+    long released_rss = mem_harness::get_current_rss_kb();
+
+    std::cout << "Live: " << live << " channels held: RSS " << live_rss / 1024.0 << " MB = "
+              << (live_rss - before_live_rss) * 1024.0 / live << " bytes/channel" << std::endl;
+    std::cout << "  RSS after release: " << released_rss / 1024.0 << " MB ("
+              << std::showpos << (released_rss - before_live_rss) / 1024.0 << std::noshowpos
+              << " MB retained)" << std::endl;
+
+    // Same shape as the harness summary so allocator-compare can read it.
+    std::cout << "Summary: steady_rss_kb=" << after_churn_rss
+              << " final_rss_kb=" << released_rss
+              << " peak_rss_kb="
+              << mem_harness::observed_peak_rss_kb({after_churn_rss, live_rss, released_rss})
+              << std::setprecision(3)
+              << " mean_iteration_ms=" << (total.create.mean() + total.destroy.mean()) / 1e6
+              << std::endl;
+
+    return 0;
+}
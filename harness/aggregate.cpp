@@ -0,0 +1,326 @@
+#include "harness/aggregate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+
+#include "harness/harness.h"
+#include "harness/rss.h"
+
+namespace mem_harness {
+namespace {
+
+// "RSS 12.30 MB | PSS 4.10 MB | private 3.90 MB | shared 8.40 MB" of the means.
+void print_footprints(const char* label, const std::vector<ChildFootprint>& footprints) {
+    if (footprints.empty()) {
+        return;
+    }
+    double rss = 0, pss = 0, priv = 0;
+    for (const ChildFootprint& f : footprints) {
+        rss += f.rss_kb;
+        pss += f.pss_kb;
+        priv += f.private_kb;
+    }
+    const double n = footprints.size();
+    std::cout << "  " << label << " per child: RSS " << rss / n / 1024.0 << " MB | PSS "
+              << pss / n / 1024.0 << " MB | private " << priv / n / 1024.0 << " MB | shared "
+              << (rss - priv) / n / 1024.0 << " MB | total PSS " << pss / 1024.0 << " MB"
+              << std::endl;
+}
+
+}  // namespace
+
+ChildFootprint measure_footprint() {
+    ChildFootprint footprint;
+    SmapsRollup rollup;
+    if (read_smaps_rollup(&rollup)) {
+        footprint.rss_kb = rollup.rss_kb;
+        footprint.pss_kb = rollup.pss_kb;
+        footprint.private_kb = rollup.private_kb;
+        footprint.valid = true;
+    }
+    return footprint;
+}
+
+SlopeFit fit_slope(const std::vector<long>& y, size_t begin) {
+    SlopeFit fit;
+    if (begin >= y.size()) {
+        return fit;
+    }
+    const size_t n = y.size() - begin;
+    fit.points = n;
+    if (n < 2) {
+        return fit;
+    }
+    double mean_x = (n - 1) / 2.0;
+    double mean_y = 0;
+    for (size_t i = begin; i < y.size(); ++i) {
+        mean_y += y[i];
+    }
+    mean_y /= n;
+    double sxx = 0, sxy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double dx = i - mean_x;
+        sxx += dx * dx;
+        sxy += dx * (y[begin + i] - mean_y);
+    }
+    fit.slope = sxy / sxx;
+    if (n > 2) {
+        double ssr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double residual = y[begin + i] - mean_y - fit.slope * (i - mean_x);
+            ssr += residual * residual;
+        }
+        fit.stderr_slope = std::sqrt(ssr / (n - 2) / sxx);
+    }
+    return fit;
+}
+
+double t_critical_95(size_t degrees_of_freedom) {
+    static const double kTable[] = {
+        0,     12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179,  2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074,  2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    constexpr size_t kEntries = sizeof(kTable) / sizeof(kTable[0]);
+    if (degrees_of_freedom == 0) {
+        return 0;
+    }
+    return degrees_of_freedom < kEntries ? kTable[degrees_of_freedom] : 1.96;
+}
+
+std::unique_ptr<ChildSlots> ChildSlots::create(int children, int points, int64_t point_ms) {
+    children = std::max(children, 0);
+    points = std::max(points, 0);
+    size_t length = children * (sizeof(Header) + points * sizeof(std::atomic<long>));
+    if (length == 0) {
+        return nullptr;
+    }
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return nullptr;
+    }
+    return std::unique_ptr<ChildSlots>(new ChildSlots(base, length, children, points, point_ms));
+}
+
+ChildSlots::ChildSlots(void* base, size_t length, int children, int points, int64_t point_ms)
+    : base_(base), length_(length), children_(children), points_(points), point_ms_(point_ms) {
+    static_assert(std::atomic<long>::is_always_lock_free, "shared slots need lock-free atomics");
+    static_assert(std::atomic<int64_t>::is_always_lock_free, "shared slots need lock-free atomics");
+    for (int c = 0; c < children_; ++c) {
+        Header* h = new (header(c)) Header;
+        h->pid.store(0, std::memory_order_relaxed);
+        h->published.store(0, std::memory_order_relaxed);
+        h->points.store(0, std::memory_order_relaxed);
+        h->iterations.store(0, std::memory_order_relaxed);
+        h->startup = ChildFootprint();
+        h->exit = ChildFootprint();
+        std::atomic<long>* s = series(c);
+        for (int i = 0; i < points_; ++i) {
+            new (&s[i]) std::atomic<long>(0);
+        }
+    }
+}
+
+ChildSlots::~ChildSlots() {
+    munmap(base_, length_);
+}
+
+ChildSlots::Header* ChildSlots::header(int child) const {
+    char* slot = static_cast<char*>(base_) +
+                 child * (sizeof(Header) + points_ * sizeof(std::atomic<long>));
+    return reinterpret_cast<Header*>(slot);
+}
+
+std::atomic<long>* ChildSlots::series(int child) const {
+    return reinterpret_cast<std::atomic<long>*>(header(child) + 1);
+}
+
+void ChildSlots::attach(int child, pid_t pid) {
+    if (child >= 0 && child < children_) {
+        header(child)->pid.store(pid, std::memory_order_relaxed);
+    }
+}
+
+void ChildSlots::publish(int child, const std::vector<long>& rss_series, int64_t iterations) {
+    if (child < 0 || child >= children_) {
+        return;
+    }
+    Header* h = header(child);
+    std::atomic<long>* s = series(child);
+    const int n = static_cast<int>(std::min(rss_series.size(), static_cast<size_t>(points_)));
+    for (int i = 0; i < n; ++i) {
+        long current = s[i].load(std::memory_order_relaxed);
+        while (rss_series[i] > current &&
+               !s[i].compare_exchange_weak(current, rss_series[i], std::memory_order_relaxed)) {
+        }
+    }
+    int points = h->points.load(std::memory_order_relaxed);
+    while (n > points && !h->points.compare_exchange_weak(points, n, std::memory_order_relaxed)) {
+    }
+    h->iterations.fetch_add(iterations, std::memory_order_relaxed);
+    h->published.fetch_add(1, std::memory_order_release);
+}
+
+void ChildSlots::report(int warmup_iterations) const {
+    std::vector<int> reporting;
+    int points = 0;
+    int64_t iterations = 0;
+    int publishers = 0;
+    for (int c = 0; c < children_; ++c) {
+        const Header* h = header(c);
+        const int published = h->published.load(std::memory_order_acquire);
+        if (published > 0) {
+            reporting.push_back(c);
+            points = std::max(points, h->points.load(std::memory_order_relaxed));
+            iterations += h->iterations.load(std::memory_order_relaxed);
+            publishers += published;
+        }
+    }
+    const int64_t iterations_per_thread = publishers > 0 ? iterations / publishers : 0;
+
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << "---------------------------------------------------------" << std::endl;
+    std::cout << "Aggregate over " << reporting.size() << "/" << children_ << " processes ("
+              << iterations_per_thread << " iterations";
+    if (point_ms_ > 0) {
+        std::cout << " per thread, sampled every " << point_ms_ << " ms";
+    }
+    std::cout << "):" << std::endl;
+    if (reporting.empty() || points == 0) {
+        return;
+    }
+
+    long peak_total = 0;
+    long final_total = 0;
+    for (int i = 0; i < points; ++i) {
+        long total = 0;
+        for (int c : reporting) {
+            if (i < header(c)->points.load(std::memory_order_relaxed)) {
+                total += series(c)[i].load(std::memory_order_relaxed);
+            }
+        }
+        peak_total = std::max(peak_total, total);
+        final_total = total;
+    }
+
+    // Slope past allocator and gRPC warm-up, as in Harness::check_leak(). In
+    // a soak each point covers per_point iterations.
+    const double per_point =
+        point_ms_ > 0 ? std::max(1.0, static_cast<double>(iterations_per_thread) / points) : 1;
+    const size_t begin =
+        warmup_iterations < 0
+            ? points / 2
+            : std::min(static_cast<size_t>(points),
+                       static_cast<size_t>(warmup_iterations / per_point));
+    std::vector<double> slopes;
+    long min_max = -1, max_max = 0;
+    double mean_max = 0;
+    pid_t max_pid = 0;
+    for (int c : reporting) {
+        std::vector<long> rss(header(c)->points.load(std::memory_order_relaxed));
+        long child_max = 0;
+        for (size_t i = 0; i < rss.size(); ++i) {
+            rss[i] = series(c)[i].load(std::memory_order_relaxed);
+            child_max = std::max(child_max, rss[i]);
+        }
+        if (child_max > max_max) {
+            max_max = child_max;
+            max_pid = header(c)->pid.load(std::memory_order_relaxed);
+        }
+        min_max = min_max < 0 ? child_max : std::min(min_max, child_max);
+        mean_max += child_max;
+        slopes.push_back(fit_slope(rss, begin).slope / per_point);
+    }
+    mean_max /= reporting.size();
+
+    // Children are independent replicates, so the interval comes from the
+    // spread of their slopes.
+    double mean_slope = 0;
+    for (double s : slopes) {
+        mean_slope += s;
+    }
+    mean_slope /= slopes.size();
+    double half_width = 0;
+    if (slopes.size() > 1) {
+        double var = 0;
+        for (double s : slopes) {
+            var += (s - mean_slope) * (s - mean_slope);
+        }
+        var /= slopes.size() - 1;
+        half_width = t_critical_95(slopes.size() - 1) * std::sqrt(var / slopes.size());
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Total RSS: final " << final_total / 1024.0 << " MB | peak "
+              << peak_total / 1024.0 << " MB" << std::endl;
+    std::cout << "  Per-process max RSS: min " << min_max / 1024.0 << " MB | mean "
+              << mean_max / 1024.0 << " MB | max " << max_max / 1024.0 << " MB (PID " << max_pid
+              << ")" << std::endl;
+    std::cout << std::setprecision(4) << "  Leak slope: " << std::showpos
+              << mean_slope / 1024.0 << std::noshowpos << " MB/iteration per process";
+    if (slopes.size() > 1) {
+        std::cout << " (95% CI " << std::showpos << (mean_slope - half_width) / 1024.0 << " .. "
+                  << (mean_slope + half_width) / 1024.0 << std::noshowpos << ")";
+    }
+    if (point_ms_ > 0) {
+        std::cout << " over samples " << begin + 1 << "-" << points << std::endl;
+    } else {
+        std::cout << " over iterations " << begin + 1 << "-" << points << std::endl;
+    }
+}
+
+void ChildSlots::publish_startup(int child, const ChildFootprint& footprint) {
+    if (child >= 0 && child < children_) {
+        header(child)->startup = footprint;
+    }
+}
+
+void ChildSlots::publish_exit(int child, const ChildFootprint& footprint) {
+    if (child >= 0 && child < children_) {
+        header(child)->exit = footprint;
+    }
+}
+
+void ChildSlots::report_footprints(const std::string& mode, long parent_rss_kb) const {
+    std::vector<double> startup_ms;
+    std::vector<ChildFootprint> at_startup, at_exit;
+    for (int c = 0; c < children_; ++c) {
+        const Header* h = header(c);
+        if (h->startup.valid) {
+            startup_ms.push_back(h->startup.startup_ms);
+            at_startup.push_back(h->startup);
+        }
+        if (h->exit.valid) {
+            at_exit.push_back(h->exit);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Fork mode: " << mode << " | parent RSS before fork " << parent_rss_kb / 1024.0
+              << " MB | " << at_startup.size() << "/" << children_ << " children reported"
+              << std::endl;
+    if (startup_ms.empty()) {
+        return;
+    }
+    std::sort(startup_ms.begin(), startup_ms.end());
+    double mean = 0;
+    for (double ms : startup_ms) {
+        mean += ms;
+    }
+    mean /= startup_ms.size();
+    std::cout << "  Startup: min " << startup_ms.front() << " ms | p50 "
+              << startup_ms[startup_ms.size() / 2] << " ms | mean " << mean << " ms | max "
+              << startup_ms.back() << " ms" << std::endl;
+    print_footprints("At startup", at_startup);
+    print_footprints("At exit", at_exit);
+}
+
+}  // namespace mem_harness
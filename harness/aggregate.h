@@ -0,0 +1,139 @@
+#ifndef HARNESS_AGGREGATE_H_
+#define HARNESS_AGGREGATE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief Least-squares line through y[i] over i, in y units per index.
+ */
+struct SlopeFit {
+    double slope = 0;
+    // Standard error of the slope; zero with fewer than three points.
+    double stderr_slope = 0;
+    size_t points = 0;
+};
+
+/**
+ * @brief Fits y[begin..] against its index.
+ */
+SlopeFit fit_slope(const std::vector<long>& y, size_t begin = 0);
+
+/**
+ * @brief Two-sided 95% Student t critical value for the given degrees of
+ * freedom (1.96 beyond the table).
+ */
+double t_critical_95(size_t degrees_of_freedom);
+
+/**
+ * @brief A process's memory from /proc/self/smaps_rollup, in KB. Shared
+ * pages (e.g. copy-on-write pages inherited from the parent) count in rss_kb
+ * but only pro rata in pss_kb.
+ */
+struct ChildFootprint {
+    // From fork() in the parent to the child's first gRPC channel; startup only.
+    double startup_ms = 0;
+    long rss_kb = 0;
+    long pss_kb = 0;
+    long private_kb = 0;
+    bool valid = false;
+};
+
+/**
+ * @brief Reads the calling process's footprint; valid is false on error.
+ */
+ChildFootprint measure_footprint();
+
+/**
+ * @brief Per-child RSS series in a MAP_SHARED anonymous segment, created by
+ * the parent before forking so every child writes into its own slot.
+ *
+ * Slots are lock-free: each child publishes its series with an atomic max
+ * per entry, so several threads in one child may publish the same
+ * process's RSS concurrently, and the parent reads after waitpid().
+ */
+class ChildSlots {
+ public:
+    /**
+     * @brief Maps a segment for children x points samples, e.g.
+     * series_capacity() of the children's harness options.
+     * @param point_ms Spacing of the samples in a soak (series_interval());
+     * zero when there is one sample per iteration.
+     * @return nullptr if the mapping failed.
+     */
+    static std::unique_ptr<ChildSlots> create(int children, int points, int64_t point_ms = 0);
+
+    ~ChildSlots();
+
+    ChildSlots(const ChildSlots&) = delete;
+    ChildSlots& operator=(const ChildSlots&) = delete;
+
+    /**
+     * @brief Called in child `child` to claim its slot.
+     */
+    void attach(int child, pid_t pid);
+
+    /**
+     * @brief Merges a harness's rss_series() into the child's slot.
+     * @param iterations Harness::iterations_run() of that harness.
+     */
+    void publish(int child, const std::vector<long>& rss_series, int64_t iterations);
+
+    /**
+     * @brief Prints total RSS across children, per-process max and the
+     * per-iteration leak slope in MB with a 95% confidence interval.
+     * @param warmup_iterations Iterations excluded from the fit, as
+     * HarnessOptions::leak_warmup_iterations; negative means the first half.
+     */
+    void report(int warmup_iterations) const;
+
+    /**
+     * @brief Records the child's footprint once it is ready (startup) and
+     * after its threads finished (exit). Call from one thread per child.
+     */
+    void publish_startup(int child, const ChildFootprint& footprint);
+    void publish_exit(int child, const ChildFootprint& footprint);
+
+    /**
+     * @brief Prints startup latency and mean RSS, PSS, private and shared
+     * memory per child at startup and exit, and the children's total PSS,
+     * which unlike total RSS counts copy-on-write pages once.
+     * @param mode Label for the fork mode, e.g. "prefork".
+     * @param parent_rss_kb The parent's RSS just before forking.
+     */
+    void report_footprints(const std::string& mode, long parent_rss_kb) const;
+
+ private:
+    struct Header {
+        std::atomic<pid_t> pid;
+        std::atomic<int> published;
+        // Longest series published, and iterations summed over publishers.
+        std::atomic<int> points;
+        std::atomic<int64_t> iterations;
+        // Written by the child before it exits, read after waitpid().
+        ChildFootprint startup;
+        ChildFootprint exit;
+    };
+
+    ChildSlots(void* base, size_t length, int children, int points, int64_t point_ms);
+
+    Header* header(int child) const;
+    std::atomic<long>* series(int child) const;
+
+    void* base_;
+    size_t length_;
+    int children_;
+    int points_;
+    int64_t point_ms_;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_AGGREGATE_H_
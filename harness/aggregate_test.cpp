@@ -0,0 +1,56 @@
+#include "harness/aggregate.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace mem_harness {
+namespace {
+
+TEST(FitSlopeTest, LinearSeriesHasExactSlope) {
+    std::vector<long> y;
+    for (int i = 0; i < 20; ++i) {
+        y.push_back(1000 + 512 * i);
+    }
+    SlopeFit fit = fit_slope(y);
+    EXPECT_DOUBLE_EQ(fit.slope, 512);
+    EXPECT_NEAR(fit.stderr_slope, 0, 1e-9);
+    EXPECT_EQ(fit.points, 20u);
+}
+
+TEST(FitSlopeTest, FlatSeriesHasZeroSlope) {
+    std::vector<long> y(30, 4096);
+    SlopeFit fit = fit_slope(y);
+    EXPECT_DOUBLE_EQ(fit.slope, 0);
+    EXPECT_DOUBLE_EQ(fit.stderr_slope, 0);
+}
+
+TEST(FitSlopeTest, SkipsWarmup) {
+    // A warm-up spike followed by a flat plateau.
+    std::vector<long> y = {0, 5000, 9000, 10000, 10000, 10000, 10000, 10000};
+    EXPECT_GT(fit_slope(y).slope, 0);
+    SlopeFit fit = fit_slope(y, 3);
+    EXPECT_DOUBLE_EQ(fit.slope, 0);
+    EXPECT_EQ(fit.points, 5u);
+}
+
+TEST(FitSlopeTest, TooFewPoints) {
+    EXPECT_EQ(fit_slope({}).points, 0u);
+    EXPECT_DOUBLE_EQ(fit_slope({7}).slope, 0);
+    EXPECT_EQ(fit_slope({1, 2, 3}, 3).points, 0u);
+    // Two points give a slope but no standard error.
+    SlopeFit fit = fit_slope({10, 30});
+    EXPECT_DOUBLE_EQ(fit.slope, 20);
+    EXPECT_DOUBLE_EQ(fit.stderr_slope, 0);
+}
+
+TEST(TCritical95Test, TableAndLimit) {
+    EXPECT_DOUBLE_EQ(t_critical_95(0), 0);
+    EXPECT_DOUBLE_EQ(t_critical_95(1), 12.706);
+    EXPECT_DOUBLE_EQ(t_critical_95(10), 2.228);
+    EXPECT_DOUBLE_EQ(t_critical_95(30), 2.042);
+    EXPECT_DOUBLE_EQ(t_critical_95(1000), 1.96);
+}
+
+}  // namespace
+}  // namespace mem_harness
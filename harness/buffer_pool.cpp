@@ -0,0 +1,226 @@
+#include "harness/buffer_pool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "harness/placement.h"
+
+namespace mem_harness {
+namespace {
+
+BufferPoolMode pool_mode = BufferPoolMode::kNone;
+BufferPool* global_pool = nullptr;
+bool thread_local_huge_pages = false;
+ThpPolicy thp_policy = ThpPolicy::kDefault;
+ReleasePolicy release_policy = ReleasePolicy::kKeep;
+int buffer_node_offset = -1;
+
+// Per-thread cache for BufferPoolMode::kThreadLocal.
+struct ThreadCache {
+    PooledBlock* block = nullptr;
+    ~ThreadCache() { unmap_block(block); }
+};
+thread_local ThreadCache thread_cache;
+
+size_t round_up(size_t n, size_t alignment) {
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+// madvise() over the whole pages inside [data, data + size).
+void advise_pages(void* data, size_t size, int advice) {
+    const uintptr_t page = sysconf(_SC_PAGE_SIZE);
+    uintptr_t begin = round_up(reinterpret_cast<uintptr_t>(data), page);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size) / page * page;
+    if (end > begin) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+    }
+}
+
+void apply_thp_policy(void* data, size_t size) {
+    if (thp_policy == ThpPolicy::kHuge) {
+        advise_pages(data, size, MADV_HUGEPAGE);
+    } else if (thp_policy == ThpPolicy::kNoHuge) {
+        advise_pages(data, size, MADV_NOHUGEPAGE);
+    }
+}
+
+void apply_node_policy(void* data, size_t size) {
+    if (buffer_node_offset < 0) {
+        return;
+    }
+    int index = numa_node_index(current_numa_node());
+    if (index >= 0) {
+        bind_pages_to_node(data, size, numa_node_at(index + buffer_node_offset));
+    }
+}
+
+void apply_release_policy(void* data, size_t size) {
+    if (release_policy == ReleasePolicy::kFree) {
+        advise_pages(data, size, MADV_FREE);
+    } else if (release_policy == ReleasePolicy::kDontNeed) {
+        advise_pages(data, size, MADV_DONTNEED);
+    }
+}
+
+}  // namespace
+
+PooledBlock* map_block(size_t size, bool huge_pages) {
+    size_t capacity = round_up(size, sysconf(_SC_PAGE_SIZE));
+    void* addr = MAP_FAILED;
+    if (huge_pages) {
+        constexpr size_t kHugePage = 2 * 1024 * 1024;
+        size_t huge_capacity = round_up(size, kHugePage);
+        addr = mmap(nullptr, huge_capacity, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) {
+            capacity = huge_capacity;
+        }
+    }
+    if (addr == MAP_FAILED) {
+        addr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        if (huge_pages) {
+            // No reserved hugetlb pages: ask for transparent huge pages instead.
+            madvise(addr, capacity, MADV_HUGEPAGE);
+        } else {
+            apply_thp_policy(addr, capacity);
+        }
+    }
+    apply_node_policy(addr, capacity);
+    // Prefault once, as the zero-filling std::vector does on every call;
+    // otherwise writes from an untouched mapping only read the zero page
+    // and the pool would look free.
+    std::memset(addr, 0, capacity);
+    return new PooledBlock{static_cast<char*>(addr), capacity};
+}
+
+void unmap_block(PooledBlock* block) {
+    if (block == nullptr) {
+        return;
+    }
+    munmap(block->data, block->capacity);
+    delete block;
+}
+
+BufferPool::BufferPool(size_t max_cached, bool huge_pages)
+    : slots_(new std::atomic<PooledBlock*>[max_cached]),
+      num_slots_(max_cached),
+      huge_pages_(huge_pages) {
+    for (size_t i = 0; i < num_slots_; ++i) {
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+BufferPool::~BufferPool() {
+    for (size_t i = 0; i < num_slots_; ++i) {
+        unmap_block(slots_[i].exchange(nullptr));
+    }
+}
+
+PooledBlock* BufferPool::acquire(size_t size) {
+    for (size_t i = 0; i < num_slots_; ++i) {
+        if (slots_[i].load(std::memory_order_relaxed) == nullptr) {
+            continue;
+        }
+        PooledBlock* block = slots_[i].exchange(nullptr, std::memory_order_acquire);
+        if (block == nullptr) {
+            continue;
+        }
+        if (block->capacity >= size) {
+            return block;
+        }
+        // Cached block is too small for this request; drop it.
+        unmap_block(block);
+    }
+    return map_block(size, huge_pages_);
+}
+
+void BufferPool::release(PooledBlock* block) {
+    for (size_t i = 0; i < num_slots_; ++i) {
+        PooledBlock* expected = nullptr;
+        if (slots_[i].compare_exchange_strong(expected, block, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+            return;
+        }
+    }
+    unmap_block(block);
+}
+
+void configure_buffer_pages(ThpPolicy thp, ReleasePolicy release) {
+    thp_policy = thp;
+    release_policy = release;
+}
+
+void configure_buffer_node(int offset) {
+    buffer_node_offset = offset;
+}
+
+std::string system_thp_mode() {
+    std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string line;
+    std::getline(in, line);
+    size_t open = line.find('[');
+    size_t close = line.find(']', open);
+    if (open == std::string::npos || close == std::string::npos) {
+        return std::string();
+    }
+    return line.substr(open + 1, close - open - 1);
+}
+
+void configure_buffer_pool(BufferPoolMode mode, bool huge_pages) {
+    pool_mode = mode;
+    thread_local_huge_pages = huge_pages;
+    if (mode == BufferPoolMode::kGlobal && global_pool == nullptr) {
+        // Never destroyed: I/O threads may still release into it during exit.
+        global_pool = new BufferPool(64, huge_pages);
+    }
+}
+
+IoBuffer::IoBuffer(size_t size) : size_(size) {
+    switch (pool_mode) {
+        case BufferPoolMode::kGlobal:
+            block_ = global_pool->acquire(size);
+            break;
+        case BufferPoolMode::kThreadLocal:
+            if (thread_cache.block != nullptr && thread_cache.block->capacity >= size) {
+                block_ = thread_cache.block;
+                thread_cache.block = nullptr;
+            } else {
+                unmap_block(thread_cache.block);
+                thread_cache.block = nullptr;
+                block_ = map_block(size, thread_local_huge_pages);
+            }
+            break;
+        case BufferPoolMode::kNone:
+            break;
+    }
+    if (block_ == nullptr) {
+        // No pool, or the mapping failed: fall back to a heap buffer. Its
+        // pages are shared with other allocations, so no policy applies.
+        owned_.resize(size);
+    } else if (release_policy != ReleasePolicy::kKeep) {
+        // Released pages read back as zero (kDontNeed) or may (kFree);
+        // touch them so reuse pays the faults a fresh buffer would.
+        std::memset(block_->data, 0, size);
+    }
+}
+
+IoBuffer::~IoBuffer() {
+    if (block_ == nullptr) {
+        return;
+    }
+    apply_release_policy(block_->data, block_->capacity);
+    if (pool_mode == BufferPoolMode::kGlobal) {
+        global_pool->release(block_);
+    } else {
+        unmap_block(thread_cache.block);
+        thread_cache.block = block_;
+    }
+}
+
+}  // namespace mem_harness
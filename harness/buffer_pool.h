@@ -0,0 +1,146 @@
+#ifndef HARNESS_BUFFER_POOL_H_
+#define HARNESS_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief A page-aligned anonymous mapping owned by the buffer pool.
+ */
+struct PooledBlock {
+    char* data = nullptr;
+    size_t capacity = 0;
+};
+
+/**
+ * @brief Where write_file/read_file get their data buffer from.
+ */
+enum class BufferPoolMode {
+    // A fresh zero-filled std::vector per call (the original behavior).
+    kNone,
+    // A process-wide lock-free free list shared by all threads.
+    kGlobal,
+    // One cached block per thread, unmapped when the thread exits. Only
+    // reused on long-lived threads (--io_mode=pool), not one thread per job.
+    kThreadLocal,
+};
+
+/**
+ * @brief Transparent huge page hint applied to data buffers before they are
+ * first touched. Effective only while the system THP mode is "madvise" or
+ * "always" (see system_thp_mode()).
+ */
+enum class ThpPolicy {
+    // No hint; the system mode decides.
+    kDefault,
+    // MADV_HUGEPAGE.
+    kHuge,
+    // MADV_NOHUGEPAGE.
+    kNoHuge,
+};
+
+/**
+ * @brief What happens to a buffer's pages when the I/O call returns it.
+ */
+enum class ReleasePolicy {
+    // Nothing; the heap or pool keeps the pages resident.
+    kKeep,
+    // MADV_FREE: reclaimed lazily under memory pressure.
+    kFree,
+    // MADV_DONTNEED: dropped immediately; the next use faults them back.
+    kDontNeed,
+};
+
+/**
+ * @brief Lock-free cache of page-aligned blocks.
+ *
+ * The free list is a fixed array of atomic slots: release() parks a block
+ * in an empty slot and acquire() takes any block that is large enough.
+ * Exchanging whole slots avoids the ABA problem of a linked free list.
+ * When every slot is full the released block is unmapped.
+ */
+class BufferPool {
+ public:
+    BufferPool(size_t max_cached, bool huge_pages);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    PooledBlock* acquire(size_t size);
+    void release(PooledBlock* block);
+
+    bool huge_pages() const { return huge_pages_; }
+
+ private:
+    std::unique_ptr<std::atomic<PooledBlock*>[]> slots_;
+    size_t num_slots_;
+    bool huge_pages_;
+};
+
+/**
+ * @brief Maps a block of at least size bytes, rounded up to whole pages.
+ * With huge_pages it tries MAP_HUGETLB first and falls back to
+ * MADV_HUGEPAGE on a regular mapping. The block is prefaulted. Returns
+ * nullptr on failure.
+ */
+PooledBlock* map_block(size_t size, bool huge_pages);
+void unmap_block(PooledBlock* block);
+
+/**
+ * @brief Selects the buffer source for every subsequent IoBuffer.
+ * Call once at startup, before any I/O threads run.
+ */
+void configure_buffer_pool(BufferPoolMode mode, bool huge_pages);
+
+/**
+ * @brief Selects the THP hint and release policy for every subsequent
+ * pooled IoBuffer. Heap-backed buffers get neither: their pages are shared
+ * with other allocations and a hint would outlive free(). Pooled blocks
+ * are re-zeroed on reuse while a release policy is set, so their faults
+ * are counted just like a fresh std::vector's. Call once at startup.
+ */
+void configure_buffer_pages(ThpPolicy thp, ReleasePolicy release);
+
+/**
+ * @brief Binds every subsequent pooled block's pages (MPOL_BIND) to the NUMA
+ * node `offset` nodes after the one the allocating thread runs on: 0 keeps
+ * buffers node-local, 1 places them on the next node to measure remote
+ * access. Negative disables binding. Call once at startup.
+ */
+void configure_buffer_node(int offset);
+
+/**
+ * @brief The bracketed value of /sys/kernel/mm/transparent_hugepage/enabled
+ * ("always", "madvise" or "never"), or empty if unavailable.
+ */
+std::string system_thp_mode();
+
+/**
+ * @brief RAII data buffer for one I/O call, borrowed from the configured pool.
+ */
+class IoBuffer {
+ public:
+    explicit IoBuffer(size_t size);
+    ~IoBuffer();
+
+    IoBuffer(const IoBuffer&) = delete;
+    IoBuffer& operator=(const IoBuffer&) = delete;
+
+    char* data() { return block_ != nullptr ? block_->data : owned_.data(); }
+    size_t size() const { return size_; }
+
+ private:
+    std::vector<char> owned_;
+    PooledBlock* block_ = nullptr;
+    size_t size_;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_BUFFER_POOL_H_
@@ -0,0 +1,324 @@
+#include "harness/cgroup.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace mem_harness {
+namespace {
+
+// Set by enter_memory_cgroup() for the exit handler. g_leaf_dir is empty
+// unless the memory controller had to be enabled on g_parent_dir.
+std::string g_parent_dir;
+std::string g_leaf_dir;
+std::string g_group_dir;
+pid_t g_owner_pid = 0;
+
+std::string cgroup2_mount() {
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    std::string line;
+    while (std::getline(mountinfo, line)) {
+        // "<id> <parent> <dev> <root> <mount point> <options> ... - <fstype> ..."
+        size_t dash = line.find(" - ");
+        if (dash == std::string::npos || line.compare(dash + 3, 8, "cgroup2 ") != 0) {
+            continue;
+        }
+        std::istringstream fields(line.substr(0, dash));
+        std::string id, parent, dev, root, mount_point;
+        if (fields >> id >> parent >> dev >> root >> mount_point) {
+            return mount_point;
+        }
+    }
+    return "";
+}
+
+bool write_file(const std::string& path, const std::string& value) {
+    std::ofstream out(path);
+    out << value;
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// memory.high / memory.max: "max" or a byte count.
+long read_limit_kb(const std::string& path) {
+    std::string text = read_file(path);
+    if (text.empty() || text.compare(0, 3, "max") == 0) {
+        return 0;
+    }
+    return std::atol(text.c_str()) / 1024;
+}
+
+// Calls fn(key, value) for every "key value" line of a flat-keyed file.
+template <typename Fn>
+bool for_each_key(const std::string& path, Fn fn) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string key;
+    long value = 0;
+    while (in >> key >> value) {
+        fn(key, value);
+    }
+    return true;
+}
+
+// "some avg10=0.12 avg60=0.05 avg300=0.01 total=12345"
+void parse_pressure_line(const std::string& line, double* avg10, uint64_t* total) {
+    const char* avg = std::strstr(line.c_str(), "avg10=");
+    const char* tot = std::strstr(line.c_str(), "total=");
+    if (avg != nullptr) {
+        *avg10 = std::atof(avg + 6);
+    }
+    if (tot != nullptr) {
+        *total = std::strtoull(tot + 6, nullptr, 10);
+    }
+}
+
+bool join_cgroup(const std::string& dir) {
+    return write_file(dir + "/cgroup.procs", std::to_string(getpid()));
+}
+
+// Undoes enable_memory_controller(): disables the controller again and
+// moves back out of the leaf. Best effort; stays in the leaf if another
+// child group still uses the controller.
+void restore_parent(const std::string& parent, const std::string& leaf) {
+    if (write_file(parent + "/cgroup.subtree_control", "-memory") && join_cgroup(parent)) {
+        rmdir(leaf.c_str());
+    }
+}
+
+// A group with processes of its own cannot enable controllers for its
+// children ("no internal processes"; the write fails with EBUSY), so first
+// move into a leaf next to the limited group. Sets *leaf if one was used.
+bool enable_memory_controller(const std::string& parent, std::string* leaf) {
+    if (read_file(parent + "/cgroup.subtree_control").find("memory") != std::string::npos) {
+        return true;
+    }
+    const std::string dir = parent + "/leaf";
+    if ((mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) || !join_cgroup(dir)) {
+        return false;
+    }
+    if (!write_file(parent + "/cgroup.subtree_control", "+memory")) {
+        join_cgroup(parent);
+        rmdir(dir.c_str());
+        return false;
+    }
+    *leaf = dir;
+    return true;
+}
+
+void leave_memory_cgroup() {
+    if (getpid() != g_owner_pid || g_group_dir.empty()) {
+        return;
+    }
+    join_cgroup(g_leaf_dir.empty() ? g_parent_dir : g_leaf_dir);
+    // Fails while forked children that outlived us are still inside.
+    rmdir(g_group_dir.c_str());
+    if (!g_leaf_dir.empty()) {
+        restore_parent(g_parent_dir, g_leaf_dir);
+    }
+}
+
+std::string format_mb(long kb) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << kb / 1024.0;
+    return out.str();
+}
+
+std::string format_delta(long delta) {
+    return (delta >= 0 ? "+" : "") + std::to_string(delta);
+}
+
+}  // namespace
+
+std::string current_cgroup_dir() {
+    const std::string mount = cgroup2_mount();
+    if (mount.empty()) {
+        return "";
+    }
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(in, line)) {
+        // The unified hierarchy is the "0::<path>" entry.
+        if (line.compare(0, 3, "0::") == 0) {
+            std::string path = line.substr(3);
+            return path == "/" ? mount : mount + path;
+        }
+    }
+    return "";
+}
+
+bool enter_memory_cgroup(long high_kb, long max_kb) {
+    const std::string parent = current_cgroup_dir();
+    if (parent.empty()) {
+        std::cerr << "Warning: no cgroup v2 hierarchy mounted; running without memory limits."
+                  << std::endl;
+        return false;
+    }
+    std::string leaf;
+    if (!enable_memory_controller(parent, &leaf)) {
+        std::cerr << "Warning: cannot enable the memory controller below " << parent
+                  << " (not delegated, or other processes in it?); running without memory "
+                  << "limits. Try systemd-run --user --scope -p Delegate=yes." << std::endl;
+        return false;
+    }
+    const std::string group = parent + "/mem_harness." + std::to_string(getpid());
+    if (mkdir(group.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Warning: cannot create " << group << ": " << std::strerror(errno)
+                  << "; running without memory limits." << std::endl;
+        if (!leaf.empty()) {
+            restore_parent(parent, leaf);
+        }
+        return false;
+    }
+    auto limit = [](long kb) { return kb > 0 ? std::to_string(kb * 1024) : std::string("max"); };
+    if (!write_file(group + "/memory.high", limit(high_kb)) ||
+        !write_file(group + "/memory.max", limit(max_kb)) || !join_cgroup(group)) {
+        std::cerr << "Warning: cannot configure or join " << group
+                  << "; running without memory limits." << std::endl;
+        rmdir(group.c_str());
+        if (!leaf.empty()) {
+            restore_parent(parent, leaf);
+        }
+        return false;
+    }
+    g_parent_dir = parent;
+    g_leaf_dir = leaf;
+    g_group_dir = group;
+    g_owner_pid = getpid();
+    std::atexit(leave_memory_cgroup);
+    return true;
+}
+
+bool read_cgroup_memory(CgroupMemory* memory) {
+    *memory = CgroupMemory();
+    const std::string dir = current_cgroup_dir();
+    if (dir.empty()) {
+        return false;
+    }
+    std::string current = read_file(dir + "/memory.current");
+    if (current.empty()) {
+        return false;
+    }
+    memory->current_kb = std::atol(current.c_str()) / 1024;
+    memory->high_kb = read_limit_kb(dir + "/memory.high");
+    memory->max_kb = read_limit_kb(dir + "/memory.max");
+
+    for_each_key(dir + "/memory.stat", [memory](const std::string& key, long value) {
+        if (key == "anon") {
+            memory->anon_kb = value / 1024;
+        } else if (key == "file") {
+            memory->file_kb = value / 1024;
+        } else if (key == "pgscan") {
+            memory->pgscan = value;
+        } else if (key == "pgsteal") {
+            memory->pgsteal = value;
+        } else if (key.compare(0, 18, "workingset_refault") == 0) {
+            // workingset_refault before 5.9, _anon and _file after.
+            memory->workingset_refault += value;
+        }
+    });
+    for_each_key(dir + "/memory.events", [memory](const std::string& key, long value) {
+        if (key == "high") {
+            memory->events_high = value;
+        } else if (key == "max") {
+            memory->events_max = value;
+        } else if (key == "oom") {
+            memory->events_oom = value;
+        } else if (key == "oom_kill") {
+            memory->events_oom_kill = value;
+        }
+    });
+
+    std::ifstream pressure(dir + "/memory.pressure");
+    std::string line;
+    while (std::getline(pressure, line)) {
+        if (line.compare(0, 5, "some ") == 0) {
+            parse_pressure_line(line, &memory->some_avg10, &memory->some_total_us);
+        } else if (line.compare(0, 5, "full ") == 0) {
+            parse_pressure_line(line, &memory->full_avg10, &memory->full_total_us);
+        }
+    }
+    return true;
+}
+
+CgroupMonitor::CgroupMonitor() {
+    available_ = read_cgroup_memory(&first_);
+    last_ = first_;
+    peak_kb_ = first_.current_kb;
+}
+
+Probe CgroupMonitor::probe() {
+    return [self = shared_from_this()](int) -> std::string {
+        if (!self->available_) {
+            return "";
+        }
+        CgroupMemory now;
+        if (!read_cgroup_memory(&now)) {
+            return "";
+        }
+        const CgroupMemory& before = self->last_;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << "cgroup: " << format_mb(now.current_kb)
+            << " MB";
+        if (now.high_kb > 0 || now.max_kb > 0) {
+            out << " (high " << (now.high_kb > 0 ? format_mb(now.high_kb) : "max") << ", max "
+                << (now.max_kb > 0 ? format_mb(now.max_kb) : "max") << ")";
+        }
+        out << " | anon " << format_mb(now.anon_kb) << " MB file " << format_mb(now.file_kb)
+            << " MB | reclaimed " << format_delta(now.pgsteal - before.pgsteal) << " pages"
+            << " | high " << format_delta(now.events_high - before.events_high) << ", max "
+            << format_delta(now.events_max - before.events_max) << ", oom_kill "
+            << format_delta(now.events_oom_kill - before.events_oom_kill) << " | PSI some "
+            << now.some_avg10 << "% full " << now.full_avg10 << "%";
+        self->peak_kb_ = std::max(self->peak_kb_, now.current_kb);
+        self->peak_some_avg10_ = std::max(self->peak_some_avg10_, now.some_avg10);
+        self->last_ = now;
+        return out.str();
+    };
+}
+
+Report CgroupMonitor::report() {
+    return [self = shared_from_this()]() -> std::string {
+        if (!self->available_) {
+            return "cgroup: memory controller files not available";
+        }
+        CgroupMemory end;
+        if (!read_cgroup_memory(&end)) {
+            end = self->last_;
+        }
+        const CgroupMemory& start = self->first_;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << "cgroup: peak "
+            << format_mb(std::max(self->peak_kb_, end.current_kb)) << " MB, final "
+            << format_mb(end.current_kb) << " MB (anon " << format_mb(end.anon_kb)
+            << " MB, file " << format_mb(end.file_kb) << " MB) | reclaim: scanned "
+            << end.pgscan - start.pgscan << ", stolen " << end.pgsteal - start.pgsteal
+            << ", refaults " << end.workingset_refault - start.workingset_refault
+            << " pages | events: high " << end.events_high - start.events_high << ", max "
+            << end.events_max - start.events_max << ", oom " << end.events_oom - start.events_oom
+            << ", oom_kill " << end.events_oom_kill - start.events_oom_kill
+            << " | PSI stall: some " << (end.some_total_us - start.some_total_us) / 1000.0
+            << " ms, full " << (end.full_total_us - start.full_total_us) / 1000.0
+            << " ms (peak some avg10 " << self->peak_some_avg10_ << "%)";
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,106 @@
+#ifndef HARNESS_CGROUP_H_
+#define HARNESS_CGROUP_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Directory of this process's cgroup v2 group, e.g.
+ * "/sys/fs/cgroup/user.slice/session-1.scope"; empty if no cgroup2
+ * hierarchy is mounted. Works on hybrid hosts (cgroup2 under .../unified).
+ */
+std::string current_cgroup_dir();
+
+/**
+ * @brief Moves the whole process into a new child group of its current
+ * cgroup, "mem_harness.<pid>", with memory.high and memory.max set to the
+ * given limits (0 leaves a limit at "max"). Processes forked afterwards
+ * start inside it. At exit the process moves back and removes the group.
+ *
+ * If the current group does not yet enable the memory controller for its
+ * children, the process first moves into a "leaf" child so the group is
+ * empty and "+memory" can be written to its cgroup.subtree_control; both
+ * are undone at exit.
+ *
+ * Needs the memory controller delegated to the current group (e.g. under
+ * `systemd-run --user --scope -p Delegate=yes`); otherwise prints why on
+ * std::cerr and returns false, leaving the process where it was.
+ */
+bool enter_memory_cgroup(long high_kb, long max_kb);
+
+/**
+ * @brief One reading of the current cgroup's memory controller files.
+ */
+struct CgroupMemory {
+    // memory.current, and memory.high / memory.max (0 when "max").
+    long current_kb = 0;
+    long high_kb = 0;
+    long max_kb = 0;
+    // memory.stat: anon is only reclaimable with swap; file is page cache.
+    long anon_kb = 0;
+    long file_kb = 0;
+    // memory.stat reclaim counters, in pages, cumulative.
+    long pgscan = 0;
+    long pgsteal = 0;
+    long workingset_refault = 0;
+    // memory.events, cumulative.
+    long events_high = 0;
+    long events_max = 0;
+    long events_oom = 0;
+    long events_oom_kill = 0;
+    // memory.pressure: "some" and "full" stall share over the last 10 s in
+    // percent, and total stall time in microseconds.
+    double some_avg10 = 0;
+    double full_avg10 = 0;
+    uint64_t some_total_us = 0;
+    uint64_t full_total_us = 0;
+};
+
+/**
+ * @brief Reads memory.current, memory.high, memory.max, memory.stat,
+ * memory.events and memory.pressure of the current cgroup.
+ * @return false if the memory controller files are not available.
+ */
+bool read_cgroup_memory(CgroupMemory* memory);
+
+/**
+ * @brief Follows the cgroup's memory, reclaim and pressure over a run.
+ *
+ * The probe reports counter deltas since its previous call, so with a
+ * report interval each line covers that interval. Must be owned by a
+ * std::shared_ptr; the hooks keep it alive.
+ */
+class CgroupMonitor : public std::enable_shared_from_this<CgroupMonitor> {
+ public:
+    CgroupMonitor();
+
+    /**
+     * @brief e.g. "cgroup: 60.12 MB (high 256.00, max 512.00) | anon 40.10 MB
+     * file 20.02 MB | reclaimed +1200 pages | high +3, max +0, oom_kill +0 |
+     * PSI some 0.12% full 0.00%".
+     */
+    Probe probe();
+
+    /**
+     * @brief End-of-run report: peak usage, final anon/file split, total
+     * reclaim, limit and OOM events and total pressure stall time.
+     */
+    Report report();
+
+ private:
+    bool available_;
+    CgroupMemory first_;
+    CgroupMemory last_;
+    long peak_kb_ = 0;
+    double peak_some_avg10_ = 0;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_CGROUP_H_
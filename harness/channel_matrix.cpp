@@ -0,0 +1,75 @@
+#include "harness/channel_matrix.h"
+
+#include <iomanip>
+#include <iostream>
+
+#include "harness/child.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+
+namespace mem_harness {
+namespace {
+
+// Fixed-size record a matrix child sends back through run_in_child().
+struct ProfileResult {
+    long initial_rss_kb = 0;
+    long final_rss_kb = 0;
+    long peak_rss_kb = 0;
+    int initial_grpc_threads = 0;
+    int final_grpc_threads = 0;
+    double elapsed_ms = 0;
+    bool passed = false;
+};
+
+ProfileResult run_profile_in_child(const ChannelProfile& profile,
+                                   const ProfileScenario& scenario) {
+    ChannelOptions options;
+    options.profile = profile;
+    channel_churn(options)(0);
+
+    ProfileResult result;
+    int64_t start = now_ns();
+    result.initial_rss_kb = get_current_rss_kb();
+    result.initial_grpc_threads = count_grpc_threads();
+    result.passed = scenario(profile);
+    result.final_rss_kb = get_current_rss_kb();
+    result.final_grpc_threads = count_grpc_threads();
+    result.peak_rss_kb = observed_peak_rss_kb({result.initial_rss_kb, result.final_rss_kb});
+    result.elapsed_ms = (now_ns() - start) / 1e6;
+    return result;
+}
+
+}  // namespace
+
+bool run_channel_matrix(const std::vector<ChannelProfile>& profiles,
+                        const ProfileScenario& scenario) {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Channel matrix: " << profiles.size() << " profiles" << std::endl;
+    std::cout << std::setw(20) << "Profile" << std::setw(18) << "Retained (MB)"
+              << std::setw(16) << "Final (MB)" << std::setw(15) << "Peak (MB)"
+              << std::setw(15) << "gRPC threads" << std::setw(14) << "Time (ms)"
+              << "  Leak check" << std::endl;
+
+    bool all_ok = true;
+    for (const ChannelProfile& profile : profiles) {
+        ProfileResult result;
+        bool ok = run_in_child([&] { return run_profile_in_child(profile, scenario); }, &result);
+        all_ok = all_ok && ok && result.passed;
+        std::cout << std::setw(20) << profile.name;
+        if (!ok) {
+            std::cout << "  FAILED" << std::endl;
+            continue;
+        }
+        std::cout << std::setw(18) << (result.final_rss_kb - result.initial_rss_kb) / 1024.0
+                  << std::setw(16) << result.final_rss_kb / 1024.0
+                  << std::setw(15) << result.peak_rss_kb / 1024.0
+                  << std::setw(15)
+                  << (std::to_string(result.initial_grpc_threads) + " -> " +
+                      std::to_string(result.final_grpc_threads))
+                  << std::setw(14) << result.elapsed_ms
+                  << "  " << (result.passed ? "PASS" : "FAIL") << std::endl;
+    }
+    return all_ok;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,32 @@
+#ifndef HARNESS_CHANNEL_MATRIX_H_
+#define HARNESS_CHANNEL_MATRIX_H_
+
+#include <functional>
+#include <vector>
+
+#include "harness/channels.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Runs one profile's loop, e.g. a quiet Harness whose channel stage
+ * is built from profile. Returns false on failure (e.g. a failed leak check).
+ */
+using ProfileScenario = std::function<bool(const ChannelProfile& profile)>;
+
+/**
+ * @brief Runs scenario once per profile and prints a table of retained,
+ * final and peak RSS and gRPC thread count per profile.
+ *
+ * Like run_sweep(), each profile runs in its own forked child, so that
+ * gRPC state, thread pools and allocator caches grown under one profile do
+ * not carry over into the next. The child first builds one channel with
+ * the profile to pay for gRPC initialization, then takes its baseline.
+ * @return false if any profile failed.
+ */
+bool run_channel_matrix(const std::vector<ChannelProfile>& profiles,
+                        const ProfileScenario& scenario);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_CHANNEL_MATRIX_H_
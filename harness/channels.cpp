@@ -0,0 +1,144 @@
+#include "harness/channels.h"
+
+#include <utility>
+
+#include <grpcpp/resource_quota.h>
+
+#include "harness/task_census.h"
+
+namespace mem_harness {
+namespace {
+
+constexpr int kMB = 1024 * 1024;
+
+bool is_default(const ChannelProfile& profile) {
+    return profile.max_receive_message_bytes < 0 && profile.max_send_message_bytes < 0 &&
+           profile.stream_lookahead_bytes <= 0 && profile.quota_bytes == 0;
+}
+
+// One quota per profile name for the whole process, as a service would
+// share a single quota across its channels. Never destroyed.
+grpc::ResourceQuota* shared_quota(const ChannelProfile& profile) {
+    static std::mutex mutex;
+    static auto* quotas = new std::unordered_map<std::string, grpc::ResourceQuota*>();
+    std::lock_guard<std::mutex> lock(mutex);
+    grpc::ResourceQuota*& quota = (*quotas)[profile.name];
+    if (quota == nullptr) {
+        quota = new grpc::ResourceQuota("mem_harness_" + profile.name);
+        quota->Resize(profile.quota_bytes);
+    }
+    return quota;
+}
+
+grpc::ChannelArguments channel_arguments(const ChannelOptions& options) {
+    grpc::ChannelArguments args;
+    if (options.local_subchannel_pool) {
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    }
+    const ChannelProfile& profile = options.profile;
+    if (profile.max_receive_message_bytes >= 0) {
+        args.SetMaxReceiveMessageSize(profile.max_receive_message_bytes);
+    }
+    if (profile.max_send_message_bytes >= 0) {
+        args.SetMaxSendMessageSize(profile.max_send_message_bytes);
+    }
+    if (profile.stream_lookahead_bytes > 0) {
+        args.SetInt(GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, profile.stream_lookahead_bytes);
+    }
+    if (profile.quota_bytes > 0) {
+        args.SetResourceQuota(*shared_quota(profile));
+    }
+    return args;
+}
+
+}  // namespace
+
+const std::vector<ChannelProfile>& channel_profiles() {
+    static const std::vector<ChannelProfile> profiles = [] {
+        std::vector<ChannelProfile> p(6);
+        p[0].name = "default";
+        p[1].name = "quota_64mb";
+        p[1].quota_bytes = 64 * kMB;
+        p[2].name = "quota_4mb";
+        p[2].quota_bytes = 4 * kMB;
+        p[3].name = "small_messages";
+        p[3].max_receive_message_bytes = 64 * 1024;
+        p[3].max_send_message_bytes = 64 * 1024;
+        p[4].name = "large_messages";
+        p[4].max_receive_message_bytes = 64 * kMB;
+        p[5].name = "small_window";
+        p[5].stream_lookahead_bytes = 16 * 1024;
+        return p;
+    }();
+    return profiles;
+}
+
+const ChannelProfile* find_channel_profile(const std::string& name) {
+    for (const ChannelProfile& profile : channel_profiles()) {
+        if (profile.name == name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+int count_grpc_threads() {
+    const std::string self = main_thread_name();
+    if (self.empty()) {
+        return -1;
+    }
+    int count = 0;
+    for (const auto& [name, threads] : thread_names()) {
+        if (name != self) {
+            count += threads;
+        }
+    }
+    return count;
+}
+
+std::string channel_target(const ChannelOptions& options, int iteration) {
+    if (!options.target.empty()) {
+        return options.target;
+    }
+    int offset = options.num_targets > 0 ? iteration % options.num_targets : iteration;
+    return "localhost:" + std::to_string(options.base_port + offset);
+}
+
+ResourceFactory channel_churn(const ChannelOptions& options) {
+    return [options](int iteration) -> Resource {
+        std::string address = channel_target(options, iteration);
+        auto creds = grpc::InsecureChannelCredentials();
+        if (!options.local_subchannel_pool && is_default(options.profile)) {
+            return grpc::CreateChannel(address, creds);
+        }
+        return grpc::CreateCustomChannel(address, creds, channel_arguments(options));
+    };
+}
+
+ChannelCache::ChannelCache(const ChannelOptions& options)
+    : creds_(grpc::InsecureChannelCredentials()), args_(channel_arguments(options)) {}
+
+std::shared_ptr<grpc::Channel> ChannelCache::get(const std::string& target) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(target);
+    if (it != channels_.end()) {
+        return it->second;
+    }
+    auto channel = grpc::CreateCustomChannel(target, creds_, args_);
+    channels_.emplace(target, channel);
+    return channel;
+}
+
+size_t ChannelCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channels_.size();
+}
+
+ResourceFactory cached_channel_churn(std::shared_ptr<ChannelCache> cache,
+                                     const ChannelOptions& options) {
+    return [cache = std::move(cache), options](int iteration) -> Resource {
+        return cache->get(channel_target(options, iteration));
+    };
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,111 @@
+#ifndef HARNESS_CHANNELS_H_
+#define HARNESS_CHANNELS_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/security/credentials.h>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Named set of channel arguments, compared against each other by the
+ * channel matrix to choose production limits.
+ */
+struct ChannelProfile {
+    std::string name = "default";
+    // GRPC_ARG_MAX_RECEIVE_MESSAGE_LENGTH / GRPC_ARG_MAX_SEND_MESSAGE_LENGTH;
+    // -1 keeps gRPC's defaults (4 MB receive, unlimited send).
+    int max_receive_message_bytes = -1;
+    int max_send_message_bytes = -1;
+    // GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES (per-stream flow-control
+    // window); 0 keeps the default.
+    int stream_lookahead_bytes = 0;
+    // Memory limit of a grpc::ResourceQuota shared by every channel built
+    // from this profile; 0 attaches no quota. No thread limit: only the sync
+    // server's thread pool honours ResourceQuota::SetMaxThreads.
+    size_t quota_bytes = 0;
+};
+
+/**
+ * @brief Built-in profiles: "default", bounded quotas, small and large
+ * message limits and a small flow-control window.
+ */
+const std::vector<ChannelProfile>& channel_profiles();
+
+/**
+ * @brief Looks up a built-in profile by name; nullptr if unknown.
+ */
+const ChannelProfile* find_channel_profile(const std::string& name);
+
+/**
+ * @brief Threads in this process started by gRPC (executors, timers,
+ * EventEngine pools), i.e. those named differently from the main thread.
+ * The harness's own threads keep the process name. -1 on error.
+ */
+int count_grpc_threads();
+
+/**
+ * @brief How the channel churn stages pick targets and build channels.
+ */
+struct ChannelOptions {
+    // First port; iteration i targets localhost:(base_port + i % num_targets).
+    int base_port = 4000;
+    // Number of distinct targets; 0 gives every iteration its own port.
+    int num_targets = 0;
+    // Set GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL so each channel owns its
+    // subchannels instead of sharing them through the global pool.
+    bool local_subchannel_pool = false;
+    // When set, every iteration uses this target instead (e.g. a live server).
+    std::string target;
+    // Channel arguments beyond the subchannel pool; the default profile sets
+    // none and uses plain CreateChannel.
+    ChannelProfile profile;
+};
+
+/**
+ * @brief localhost target for the given iteration under options.
+ */
+std::string channel_target(const ChannelOptions& options, int iteration);
+
+/**
+ * @brief Creates a gRPC channel per iteration with fresh insecure
+ * credentials; nothing listens on the target, so it never connects.
+ */
+ResourceFactory channel_churn(const ChannelOptions& options = ChannelOptions());
+
+/**
+ * @brief Thread-safe cache of channels keyed by target, all built from one
+ * shared ChannelCredentials and the same channel arguments.
+ */
+class ChannelCache {
+ public:
+    explicit ChannelCache(const ChannelOptions& options);
+
+    std::shared_ptr<grpc::Channel> get(const std::string& target);
+    size_t size() const;
+
+ private:
+    std::shared_ptr<grpc::ChannelCredentials> creds_;
+    grpc::ChannelArguments args_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<grpc::Channel>> channels_;
+};
+
+/**
+ * @brief Churn stage that fetches the iteration's channel from cache instead
+ * of creating one; its destroy phase only drops a reference.
+ */
+ResourceFactory cached_channel_churn(std::shared_ptr<ChannelCache> cache,
+                                     const ChannelOptions& options = ChannelOptions());
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_CHANNELS_H_
@@ -0,0 +1,53 @@
+#include "harness/child.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace mem_harness {
+
+bool run_in_child(const std::function<void(void* result)>& fn, void* result, size_t size) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::unique_ptr<char[]> buf(new char[size]());
+        fn(buf.get());
+        ssize_t written = write(fds[1], buf.get(), size);
+        (void)written;
+        close(fds[1]);
+        // Skip static destructors; the parent owns all shared state.
+        _exit(0);
+    } else if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    close(fds[1]);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fds[0], static_cast<char*>(result) + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return done == size && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,32 @@
+#ifndef HARNESS_CHILD_H_
+#define HARNESS_CHILD_H_
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+namespace mem_harness {
+
+/**
+ * @brief Runs fn in a forked child and copies the size bytes it leaves in
+ * its result buffer back into *result through a pipe.
+ *
+ * The child skips static destructors on exit; the parent owns all shared
+ * state. Used to isolate sweep points and channel profiles from each other.
+ * @return false if the fork failed, the child sent fewer than size bytes,
+ * or it did not exit with status 0.
+ */
+bool run_in_child(const std::function<void(void* result)>& fn, void* result, size_t size);
+
+/**
+ * @brief run_in_child() for a fn returning a trivially copyable record.
+ */
+template <typename T, typename Fn>
+bool run_in_child(Fn&& fn, T* result) {
+    static_assert(std::is_trivially_copyable<T>::value, "T is sent through a pipe as raw bytes");
+    return run_in_child([&fn](void* out) { *static_cast<T*>(out) = fn(); }, result, sizeof(T));
+}
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_CHILD_H_
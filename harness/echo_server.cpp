@@ -0,0 +1,82 @@
+#include "harness/echo_server.h"
+
+#include <iostream>
+#include <mutex>
+
+#include <grpcpp/security/server_credentials.h>
+
+namespace mem_harness {
+namespace {
+
+/**
+ * @brief Echoes messages one at a time; a unary call is a stream of one.
+ */
+class EchoReactor : public grpc::ServerGenericBidiReactor {
+ public:
+    explicit EchoReactor(bool unary) : unary_(unary) { StartRead(&message_); }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            // Client half-closed the stream.
+            Finish(grpc::Status::OK);
+            return;
+        }
+        StartWrite(&message_);
+    }
+
+    void OnWriteDone(bool ok) override {
+        if (!ok || unary_) {
+            Finish(ok ? grpc::Status::OK : grpc::Status::CANCELLED);
+            return;
+        }
+        StartRead(&message_);
+    }
+
+    void OnDone() override { delete this; }
+
+ private:
+    const bool unary_;
+    grpc::ByteBuffer message_;
+};
+
+}  // namespace
+
+class EchoServer::Service : public grpc::CallbackGenericService {
+ public:
+    grpc::ServerGenericBidiReactor* CreateReactor(
+        grpc::GenericCallbackServerContext* ctx) override {
+        if (ctx->method() == kEchoUnaryMethod) {
+            return new EchoReactor(/*unary=*/true);
+        }
+        if (ctx->method() == kEchoStreamMethod) {
+            return new EchoReactor(/*unary=*/false);
+        }
+        return grpc::CallbackGenericService::CreateReactor(ctx);
+    }
+};
+
+EchoServer::EchoServer() : service_(std::make_unique<Service>()) {}
+
+EchoServer::~EchoServer() {
+    if (server_) {
+        server_->Shutdown();
+        server_->Wait();
+    }
+}
+
+std::unique_ptr<EchoServer> EchoServer::start() {
+    std::unique_ptr<EchoServer> echo(new EchoServer());
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterCallbackGenericService(echo->service_.get());
+    echo->server_ = builder.BuildAndStart();
+    if (!echo->server_ || port == 0) {
+        std::cerr << "Error: Could not start echo server." << std::endl;
+        return nullptr;
+    }
+    echo->target_ = "localhost:" + std::to_string(port);
+    return echo;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,54 @@
+#ifndef HARNESS_ECHO_SERVER_H_
+#define HARNESS_ECHO_SERVER_H_
+
+#include <memory>
+#include <string>
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+
+namespace mem_harness {
+
+// Methods served by EchoServer. Messages are opaque ByteBuffers, so no
+// protobuf code generation is needed on either side.
+constexpr char kEchoUnaryMethod[] = "/mem_harness.Echo/Unary";
+constexpr char kEchoStreamMethod[] = "/mem_harness.Echo/Stream";
+
+/**
+ * @brief In-process gRPC server echoing every message back.
+ *
+ * Implemented as a callback generic service: kEchoUnaryMethod answers the
+ * single request and finishes; kEchoStreamMethod echoes each message until
+ * the client half-closes.
+ */
+class EchoServer {
+ public:
+    /**
+     * @brief Starts listening on an ephemeral localhost port.
+     * @return nullptr if the server could not be started.
+     */
+    static std::unique_ptr<EchoServer> start();
+
+    ~EchoServer();
+
+    EchoServer(const EchoServer&) = delete;
+    EchoServer& operator=(const EchoServer&) = delete;
+
+    /**
+     * @brief "localhost:<port>" for clients.
+     */
+    const std::string& target() const { return target_; }
+
+ private:
+    class Service;
+
+    EchoServer();
+
+    std::unique_ptr<Service> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::string target_;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_ECHO_SERVER_H_
@@ -0,0 +1,440 @@
+#include "harness/file_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "harness/buffer_pool.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+#include "harness/uring.h"
+
+namespace mem_harness {
+namespace {
+
+std::atomic<uint64_t> io_calls{0};
+std::atomic<uint64_t> io_bytes{0};
+std::atomic<uint64_t> io_ns{0};
+
+void record_io(size_t bytes, int64_t start_ns) {
+    io_calls.fetch_add(1, std::memory_order_relaxed);
+    io_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    io_ns.fetch_add(now_ns() - start_ns, std::memory_order_relaxed);
+}
+
+WriteEngine write_engine = WriteEngine::kStream;
+size_t write_chunk_size = 1024 * 1024;
+unsigned write_uring_depth = 8;
+
+// O_DIRECT needs buffer, offset and length aligned to the logical block
+// size; a page is a safe upper bound.
+constexpr size_t kDirectAlignment = 4096;
+
+void warn_once(std::atomic<bool>* warned, const char* message) {
+    if (!warned->exchange(true)) {
+        std::cerr << "Warning: " << message << std::endl;
+    }
+}
+
+bool pwrite_all(int fd, const char* buf, size_t len, size_t chunk, off_t offset = 0) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(fd, buf + done, std::min(chunk, len - done), offset + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+size_t align_up(size_t n) {
+    return (n + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment;
+}
+
+// O_DIRECT needs aligned memory, offsets and lengths. Page-aligned (pooled)
+// data is written in place; anything else, and the zero-padded tail, is
+// staged through one aligned buffer of at most chunk bytes, so the staging
+// never costs a second full-size copy of the buffer. chunk must be a
+// multiple of kDirectAlignment; the caller truncates the padding away.
+bool direct_write_all(int fd, const char* data, size_t size, size_t chunk) {
+    size_t in_place = 0;
+    if (reinterpret_cast<uintptr_t>(data) % kDirectAlignment == 0) {
+        in_place = size / kDirectAlignment * kDirectAlignment;
+        if (!pwrite_all(fd, data, in_place, chunk)) {
+            return false;
+        }
+    }
+    if (in_place == size) {
+        return true;
+    }
+    const size_t stage_size = std::min(chunk, align_up(size - in_place));
+    std::unique_ptr<char, decltype(&std::free)> stage(
+        static_cast<char*>(std::aligned_alloc(kDirectAlignment, stage_size)), &std::free);
+    if (!stage) {
+        std::cerr << "Error: could not allocate the O_DIRECT staging buffer." << std::endl;
+        return false;
+    }
+    for (size_t offset = in_place; offset < size;) {
+        size_t n = std::min(stage_size, size - offset);
+        size_t padded = align_up(n);
+        std::memcpy(stage.get(), data + offset, n);
+        std::memset(stage.get() + n, 0, padded - n);
+        if (!pwrite_all(fd, stage.get(), padded, padded, offset)) {
+            return false;
+        }
+        offset += n;
+    }
+    return true;
+}
+
+bool uring_write_all(int fd, const char* buf, size_t len) {
+    // One ring per thread, set up on first use and torn down at thread exit.
+    thread_local std::unique_ptr<Uring> ring;
+    thread_local bool unavailable = false;
+    // Set once a write on this thread's ring has completed.
+    thread_local bool proven = false;
+    static std::atomic<bool> warned{false};
+    if (!ring && !unavailable) {
+        ring = std::make_unique<Uring>();
+        if (!ring->init(write_uring_depth)) {
+            ring.reset();
+            unavailable = true;
+        }
+    }
+    if (!ring) {
+        warn_once(&warned, "io_uring unavailable; --write_engine=uring falls back to pwrite.");
+        return pwrite_all(fd, buf, len, write_chunk_size);
+    }
+    if (ring->write_all(fd, buf, len, write_chunk_size)) {
+        proven = true;
+        return true;
+    }
+    if (!proven && ring->last_error() < 0) {
+        // The ring sets up but rejects the write itself, e.g. -EINVAL for
+        // IORING_OP_WRITE before 5.6: stop using it and redo the write.
+        ring.reset();
+        unavailable = true;
+        warn_once(&warned, "io_uring unavailable; --write_engine=uring falls back to pwrite.");
+        return pwrite_all(fd, buf, len, write_chunk_size);
+    }
+    return false;
+}
+
+// write_file() for every engine except kStream. Reports its own errors.
+bool fd_write_file(const std::string& file_path, size_t size) {
+    static std::atomic<bool> warned_direct{false};
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    bool direct = write_engine == WriteEngine::kDirect;
+    int fd = -1;
+    if (direct) {
+        fd = open(file_path.c_str(), flags | O_DIRECT, 0644);
+        if (fd < 0 && errno == EINVAL) {
+            // e.g. tmpfs, which has no O_DIRECT support.
+            warn_once(&warned_direct, "O_DIRECT not supported here; falling back to pwrite.");
+            direct = false;
+        }
+    }
+    if (fd < 0) {
+        fd = open(file_path.c_str(), flags, 0644);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: File '" << file_path << "' could not be opened." << std::endl;
+        return false;
+    }
+
+    IoBuffer data_buffer(size);
+    bool ok = true;
+    if (direct) {
+        size_t chunk =
+            std::max(kDirectAlignment, write_chunk_size / kDirectAlignment * kDirectAlignment);
+        ok = direct_write_all(fd, data_buffer.data(), size, chunk) && ftruncate(fd, size) == 0;
+    } else if (write_engine == WriteEngine::kUring) {
+        ok = uring_write_all(fd, data_buffer.data(), size);
+    } else {
+        ok = pwrite_all(fd, data_buffer.data(), size, write_chunk_size);
+    }
+    if (!ok) {
+        std::cerr << "Error: Write to '" << file_path << "' failed." << std::endl;
+    }
+    close(fd);
+    return ok;
+}
+
+bool write_zero_file(const std::string& file_path, size_t size) {
+    std::ofstream outfile(file_path, std::ios::binary | std::ios::trunc);
+    if (!outfile.is_open()) {
+        return false;
+    }
+
+    // Write null bytes to simulate a large file.
+    std::vector<char> zero_chunk(1024 * 1024, '\0');
+    for (size_t written = 0; written < size; written += zero_chunk.size()) {
+        size_t write_size = std::min(zero_chunk.size(), size - written);
+        outfile.write(zero_chunk.data(), write_size);
+    }
+    outfile.close();
+    return outfile.good();
+}
+
+bool copy_file(const std::string& from, const std::string& to, size_t size) {
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    size_t copied = 0;
+    int error = 0;
+    while (copied < size) {
+        ssize_t n = copy_file_range(in, nullptr, out, nullptr, size - copied, 0);
+        if (n <= 0) {
+            // Zero bytes: the source ended early.
+            error = n < 0 ? errno : EIO;
+            break;
+        }
+        copied += n;
+    }
+    close(in);
+    close(out);
+    // Reported by the caller; close() must not clobber it.
+    errno = error;
+    return copied == size;
+}
+
+}  // namespace
+
+void configure_write_engine(WriteEngine engine, size_t chunk_size, unsigned uring_depth) {
+    write_engine = engine;
+    write_chunk_size = std::max<size_t>(chunk_size, 4096);
+    write_uring_depth = std::max(uring_depth, 1u);
+}
+
+void write_file(const std::string& file_path, size_t size) {
+    int64_t start = now_ns();
+    if (write_engine != WriteEngine::kStream) {
+        if (fd_write_file(file_path, size)) {
+            record_io(size, start);
+        }
+        return;
+    }
+
+    // Open the file for writing in binary mode, truncating if it exists
+    std::ofstream file(file_path, std::ios::binary | std::ios::out | std::ios::trunc);
+
+    if (!file.is_open()) {
+        std::cerr << "Error: File '" << file_path << "' could not be opened." << std::endl;
+        return;
+    }
+
+    // Borrow a buffer (by default a fresh heap std::vector). This simulates
+    // the temporary memory consumption of a large write.
+    IoBuffer data_buffer(size);
+
+    // Write the data from the buffer.
+    file.write(data_buffer.data(), size);
+
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Write to '" << file_path << "' failed." << std::endl;
+        return;
+    }
+    record_io(size, start);
+
+    // The data_buffer is released (or returned to the pool) when the
+    // function exits (goes out of scope).
+}
+
+void read_file(const std::string& file_path, size_t size) {
+    int64_t start = now_ns();
+    // Open the file for reading in binary mode
+    std::ifstream file(file_path, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "Error: File '" << file_path << "' not found." << std::endl;
+        return;
+    }
+
+    // Borrow a buffer (by default a fresh heap std::vector). This simulates
+    // the temporary memory consumption when reading the large file chunk.
+    // In Python, this is what f.read(size) does internally.
+    IoBuffer data_buffer(size);
+
+    // Read the data into the buffer.
+    file.read(data_buffer.data(), size);
+
+    file.close();
+    record_io(file.gcount(), start);
+}
+
+MappedFile::~MappedFile() {
+    if (addr_ != nullptr) {
+        munmap(addr_, size_);
+    }
+}
+
+bool MappedFile::open(const std::string& file_path, size_t size) {
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Error: File '" << file_path << "' not found." << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size = std::min(size, static_cast<size_t>(st.st_size));
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    // Before the first touch, so it shapes how the pages are read in.
+    madvise(addr, size, MADV_SEQUENTIAL);
+    addr_ = addr;
+    size_ = size;
+    return true;
+}
+
+void MappedFile::read(bool release) {
+    if (addr_ == nullptr) {
+        return;
+    }
+    int64_t start = now_ns();
+    const char* data = static_cast<const char*>(addr_);
+    const size_t page_size = sysconf(_SC_PAGE_SIZE);
+    volatile char sink = 0;
+    for (size_t offset = 0; offset < size_; offset += page_size) {
+        sink = sink + data[offset];
+    }
+    record_io(size_, start);
+
+    MemorySample sample;
+    sample_memory(&sample);
+    touched_file_kb_.store(sample.file_kb, std::memory_order_relaxed);
+    if (release) {
+        madvise(addr_, size_, MADV_DONTNEED);
+        sample_memory(&sample);
+    }
+    released_file_kb_.store(sample.file_kb, std::memory_order_relaxed);
+}
+
+bool create_mock_file(const std::string& file_path, size_t size, const MockFileOptions& options) {
+    struct stat st;
+    if (options.reuse_existing && stat(file_path.c_str(), &st) == 0 &&
+        static_cast<size_t>(st.st_size) == size) {
+        std::cout << "Reusing mock file at: " << file_path << std::endl;
+        return true;
+    }
+
+    int64_t start = now_ns();
+    std::cout << "Generating temporary file of size " << size / (1024.0 * 1024.0) << " MB..."
+              << std::endl;
+    bool ok = true;
+    switch (options.mode) {
+        case MockFileMode::kWrite:
+            ok = write_zero_file(file_path, size);
+            break;
+        case MockFileMode::kFallocate:
+        case MockFileMode::kSparse: {
+            int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                ok = false;
+                break;
+            }
+            if (options.mode == MockFileMode::kFallocate) {
+                ok = posix_fallocate(fd, 0, size) == 0;
+            } else {
+                ok = ftruncate(fd, size) == 0;
+            }
+            close(fd);
+            break;
+        }
+        case MockFileMode::kCopy: {
+            std::string template_path = options.template_path.empty()
+                                            ? file_path + ".template"
+                                            : options.template_path;
+            if (stat(template_path.c_str(), &st) != 0 || static_cast<size_t>(st.st_size) != size) {
+                ok = write_zero_file(template_path, size);
+            }
+            if (ok && !copy_file(template_path, file_path, size)) {
+                // copy_file_range() fails across file systems (EXDEV) and on
+                // kernels or file systems without it (ENOSYS, EINVAL).
+                std::cerr << "Warning: copying " << template_path << " failed ("
+                          << std::strerror(errno) << "); writing the mock file instead."
+                          << std::endl;
+                ok = write_zero_file(file_path, size);
+            }
+            break;
+        }
+    }
+    if (!ok) {
+        std::cerr << "Error: Could not create mock file at " << file_path << std::endl;
+        return false;
+    }
+    std::cout << "Mock file created at: " << file_path << " in " << std::fixed
+              << std::setprecision(2) << (now_ns() - start) / 1e6 << " ms" << std::endl;
+    return true;
+}
+
+IoStats get_io_stats() {
+    IoStats stats;
+    stats.calls = io_calls.load(std::memory_order_relaxed);
+    stats.bytes = io_bytes.load(std::memory_order_relaxed);
+    stats.ns = io_ns.load(std::memory_order_relaxed);
+    return stats;
+}
+
+Probe io_throughput_probe() {
+    return [last = get_io_stats()](int) mutable {
+        IoStats now = get_io_stats();
+        IoStats stats;
+        stats.calls = now.calls - last.calls;
+        stats.bytes = now.bytes - last.bytes;
+        stats.ns = now.ns - last.ns;
+        last = now;
+        if (stats.ns == 0 || stats.calls == 0) {
+            return std::string();
+        }
+        double mb_per_s = (stats.bytes / (1024.0 * 1024.0)) / (stats.ns / 1e9);
+        double ms_per_call = stats.ns / 1e6 / stats.calls;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << "I/O: " << mb_per_s << " MB/s, "
+            << std::setprecision(2) << ms_per_call << " ms/call";
+        return out.str();
+    };
+}
+
+Probe mapped_file_probe(const MappedFile* file) {
+    return [file](int) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << "Mapped: " << file->touched_file_kb() / 1024.0
+            << " -> " << file->released_file_kb() / 1024.0 << " MB file";
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
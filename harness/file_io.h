@@ -0,0 +1,156 @@
+#ifndef HARNESS_FILE_IO_H_
+#define HARNESS_FILE_IO_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief How write_file() moves the buffer to the file.
+ */
+enum class WriteEngine {
+    // std::ofstream, with its own buffer on top of the page cache (original).
+    kStream,
+    // Raw pwrite() in chunk-sized calls.
+    kPwrite,
+    // O_DIRECT pwrite() from a page-aligned buffer, bypassing the page cache.
+    kDirect,
+    // io_uring with a batch of chunk-sized IORING_OP_WRITE SQEs in flight.
+    kUring,
+};
+
+/**
+ * @brief Selects the engine used by every subsequent write_file() call.
+ * Engines the file system or kernel reject fall back to kPwrite.
+ * @param chunk_size Bytes per pwrite() call or SQE.
+ * @param uring_depth Submission queue depth for kUring.
+ */
+void configure_write_engine(WriteEngine engine, size_t chunk_size, unsigned uring_depth);
+
+/**
+ * @brief Writes a large chunk of data to the file from a temporary buffer.
+ *
+ * The buffer comes from the configured buffer pool (see
+ * configure_buffer_pool); without a pool it is allocated on the heap and
+ * released upon function exit. The write goes through the engine chosen
+ * with configure_write_engine(). A failed open or write is reported on
+ * stderr and left out of the I/O totals.
+ * @param file_path The path to the file to write.
+ * @param size Number of bytes to write.
+ */
+void write_file(const std::string& file_path, size_t size);
+
+/**
+ * @brief Reads a large chunk of data from the file into a temporary buffer.
+ *
+ * The buffer comes from the configured buffer pool, as for write_file().
+ * @param file_path The path to the file to read.
+ * @param size Number of bytes to read.
+ */
+void read_file(const std::string& file_path, size_t size);
+
+/**
+ * @brief Zero-copy counterpart of read_file(): a private read-only mapping
+ * of the file, kept for the object's lifetime so no anonymous memory is
+ * involved and the touched pages stay resident as file-backed RSS.
+ *
+ * The mapping is advised MADV_SEQUENTIAL and then populated by touching
+ * every page, so the advice governs the readahead.
+ */
+class MappedFile {
+ public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Maps the first size bytes of the file (fewer if it is shorter).
+     * @return false if the file could not be opened or mapped.
+     */
+    bool open(const std::string& file_path, size_t size);
+
+    /**
+     * @brief Touches one byte per page, as a consumer of the data would.
+     * Counts toward get_io_stats() like read_file().
+     * @param release Then drop the pages from the mapping with
+     * MADV_DONTNEED, so later stages run without them; otherwise they stay
+     * mapped until the next read() or destruction.
+     */
+    void read(bool release);
+
+    // File-backed RSS of the process after the last read() touched the
+    // mapping, and after its release (equal without one), in KB.
+    long touched_file_kb() const { return touched_file_kb_.load(std::memory_order_relaxed); }
+    long released_file_kb() const { return released_file_kb_.load(std::memory_order_relaxed); }
+
+ private:
+    void* addr_ = nullptr;
+    size_t size_ = 0;
+    std::atomic<long> touched_file_kb_{0};
+    std::atomic<long> released_file_kb_{0};
+};
+
+/**
+ * @brief Probe with the file-backed RSS around the last MappedFile::read()
+ * release, e.g. "Mapped: 31.20 -> 1.20 MB file".
+ */
+Probe mapped_file_probe(const MappedFile* file);
+
+/**
+ * @brief How create_mock_file() produces the file contents.
+ */
+enum class MockFileMode {
+    // Write zeros 1 MB at a time through std::ofstream (original).
+    kWrite,
+    // fallocate(): blocks are reserved up front and read back as zeros.
+    kFallocate,
+    // ftruncate() only: a sparse file, holes read back as zeros.
+    kSparse,
+    // copy_file_range() from a cached template, built on first use with kWrite.
+    // Reflink-capable file systems make this a metadata-only copy.
+    kCopy,
+};
+
+struct MockFileOptions {
+    MockFileMode mode = MockFileMode::kWrite;
+    // Keep an existing file whose size already matches instead of regenerating it.
+    bool reuse_existing = false;
+    // Template for kCopy; defaults to "<file_path>.template".
+    std::string template_path;
+};
+
+/**
+ * @brief Creates a zero-filled file of the given size for the read scenario.
+ * @return false if the file could not be created.
+ */
+bool create_mock_file(const std::string& file_path, size_t size,
+                      const MockFileOptions& options = MockFileOptions());
+
+/**
+ * @brief Process-wide totals for write_file/read_file, timed from open to close.
+ */
+struct IoStats {
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    uint64_t ns = 0;
+};
+
+IoStats get_io_stats();
+
+/**
+ * @brief Probe reporting the I/O throughput in MB/s and the mean latency of
+ * one write_file/read_file call since the previous call (process-wide, like
+ * page_fault_probe()).
+ */
+Probe io_throughput_probe();
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_FILE_IO_H_
@@ -0,0 +1,461 @@
+#include "harness/flags.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/strings/str_split.h"
+#include "harness/buffer_pool.h"
+#include "harness/cgroup.h"
+#include "harness/channel_matrix.h"
+#include "harness/echo_server.h"
+#include "harness/heap_counters.h"
+#include "harness/helper_thread.h"
+#include "harness/heap_profile.h"
+#include "harness/file_io.h"
+#include "harness/malloc_stats.h"
+#include "harness/placement.h"
+#include "harness/results.h"
+#include "harness/rpc_workload.h"
+#include "harness/worker_pool.h"
+
+ABSL_FLAG(std::string, load, "pause",
+          "Iteration pacing: pause (the binary's fixed sleep after each iteration), closed "
+          "(back to back), constant or poisson (open loop at --rate).");
+ABSL_FLAG(double, rate, 10, "Target iterations per second for --load=constant|poisson.");
+ABSL_FLAG(uint64_t, seed, 0,
+          "Seed for the --load=poisson schedule, for repeatable runs; 0 seeds from the clock.");
+ABSL_FLAG(int64_t, soak_s, 0,
+          "Soak: run each loop for this many seconds instead of a fixed iteration count.");
+ABSL_FLAG(double, report_interval_s, 0,
+          "Print at most one iteration line per this many seconds (e.g. 60 in a soak); "
+          "0 prints every iteration.");
+ABSL_FLAG(int64_t, cgroup_memory_high_mb, 0,
+          "Run inside a new cgroup v2 group with this memory.high (reclaim throttling "
+          "threshold), in MB; 0 leaves it unlimited.");
+ABSL_FLAG(int64_t, cgroup_memory_max_mb, 0,
+          "Run inside a new cgroup v2 group with this memory.max (OOM-kill limit), in MB; "
+          "0 leaves it unlimited.");
+ABSL_FLAG(bool, cgroup_stats, false,
+          "Report the cgroup's memory.stat, memory.events and memory.pressure every "
+          "iteration; implied by the cgroup limits.");
+ABSL_FLAG(int32_t, sample_interval_us, 0,
+          "Background memory sampling interval in microseconds (e.g. 1000); "
+          "0 disables the sampler thread.");
+ABSL_FLAG(int32_t, sample_ring_capacity, 1 << 16,
+          "Capacity of the sampler ring buffer, in samples.");
+ABSL_FLAG(int32_t, max_kept_samples, 1 << 18,
+          "Most background samples kept for the phase summary; later samples only "
+          "update the peak RSS.");
+ABSL_FLAG(int32_t, release_tolerance_kb, 1024,
+          "RSS within this many KB of the pre-phase level counts as released.");
+
+ABSL_FLAG(bool, malloc_stats, false,
+          "Report glibc arena count, in-use, free-but-retained and top-chunk "
+          "size (malloc_info) every iteration, with in-use/free per arena.");
+ABSL_FLAG(int64_t, malloc_arena_max, -1, "mallopt(M_ARENA_MAX); -1 keeps the default.");
+ABSL_FLAG(int64_t, malloc_trim_threshold, -1,
+          "mallopt(M_TRIM_THRESHOLD) in bytes; -1 keeps the default.");
+ABSL_FLAG(int64_t, malloc_mmap_threshold, -1,
+          "mallopt(M_MMAP_THRESHOLD) in bytes; -1 keeps the default.");
+
+ABSL_FLAG(std::string, io_mode, "spawn",
+          "How file I/O jobs run: 'spawn' (a std::thread per job) or 'pool' "
+          "(a fixed pool of long-lived workers).");
+ABSL_FLAG(int32_t, io_pool_size, 4, "Number of workers in the --io_mode=pool pool.");
+ABSL_FLAG(std::string, buffer_pool, "none",
+          "Source of the write/read data buffer: 'none' (fresh std::vector per "
+          "call), 'global' (shared lock-free pool) or 'thread_local' (one block per "
+          "thread; implies --io_mode=pool).");
+ABSL_FLAG(bool, buffer_huge_pages, false,
+          "Back pooled buffers with huge pages (MAP_HUGETLB, else MADV_HUGEPAGE).");
+ABSL_FLAG(std::string, buffer_thp, "default",
+          "Transparent huge page hint for pooled I/O buffers: default (no hint), huge "
+          "(MADV_HUGEPAGE) or nohuge (MADV_NOHUGEPAGE).");
+ABSL_FLAG(std::string, buffer_release, "keep",
+          "What happens to a pooled I/O buffer's pages after each call: keep, free "
+          "(MADV_FREE) or dontneed (MADV_DONTNEED).");
+ABSL_FLAG(bool, page_faults, false, "Report minor/major page faults per iteration.");
+ABSL_FLAG(std::string, pin, "none",
+          "Thread placement in the concurrent binary: none, cpu (one CPU per thread) or "
+          "node (one NUMA node per process, memory preferred there).");
+ABSL_FLAG(int32_t, buffer_node_offset, -1,
+          "Bind pooled I/O buffers to the NUMA node this many nodes after the allocating "
+          "thread's (0: local, 1: remote); -1 leaves placement to the kernel.");
+ABSL_FLAG(bool, numa_maps, false, "Report resident memory per NUMA node every iteration.");
+ABSL_FLAG(std::string, write_engine, "stream",
+          "write_file engine: 'stream' (std::ofstream), 'pwrite' (chunked "
+          "pwrite), 'direct' (O_DIRECT pwrite) or 'uring' (batched io_uring).");
+ABSL_FLAG(int32_t, write_chunk_kb, 1024, "Bytes per pwrite() call or io_uring SQE, in KB.");
+ABSL_FLAG(int32_t, uring_depth, 8, "io_uring submission queue depth for --write_engine=uring.");
+ABSL_FLAG(std::string, channel_mode, "per_iteration",
+          "Channel churn: 'per_iteration' (new channel and credentials every "
+          "iteration) or 'cached' (reuse channels keyed by target).");
+ABSL_FLAG(std::string, subchannel_pool, "global",
+          "'global' shares subchannels process-wide; 'local' sets "
+          "GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL on every channel.");
+ABSL_FLAG(int32_t, channel_targets, 0,
+          "Number of distinct localhost targets cycled through; 0 gives every "
+          "iteration its own port (so a cache never hits).");
+ABSL_FLAG(std::string, channel_profile, "default",
+          "Channel arguments: default, quota_64mb, quota_4mb "
+          "(bounded grpc::ResourceQuota), small_messages, large_messages (message "
+          "size limits) or small_window (HTTP/2 stream lookahead).");
+ABSL_FLAG(std::string, channel_matrix, "",
+          "Run the loop once per channel profile ('all' or a comma-separated list) "
+          "and print RSS and gRPC thread count per profile.");
+ABSL_FLAG(bool, rpc, false,
+          "Point the channels at an in-process echo server and send RPC traffic "
+          "over each iteration's channel.");
+ABSL_FLAG(int32_t, rpc_message_size, 1024, "Payload bytes per RPC message.");
+ABSL_FLAG(int32_t, rpc_per_iteration, 10, "Unary calls (or stream messages) per iteration.");
+ABSL_FLAG(bool, rpc_streaming, false,
+          "Echo over one bidi stream per iteration instead of unary calls.");
+ABSL_FLAG(std::string, rpc_api, "sync",
+          "Client execution model for --rpc: sync (blocking, one thread per outstanding RPC), "
+          "async (CompletionQueue) or callback (reactor).");
+ABSL_FLAG(int32_t, rpc_outstanding, 1, "RPCs in flight at once on each channel.");
+ABSL_FLAG(int32_t, leak_warmup_iterations, -1,
+          "Iterations skipped before fitting the leak slope; negative skips the first half.");
+ABSL_FLAG(double, leak_threshold_mb, 0,
+          "Exit non-zero when the RSS slope exceeds this many MB per iteration; 0 only "
+          "reports it.");
+ABSL_FLAG(int32_t, io_thread_stack_kb, 0,
+          "Stack size of the per-iteration I/O helper thread (--io_mode=spawn), via "
+          "pthread_attr_setstacksize; 0 keeps std::thread and the default stack.");
+ABSL_FLAG(bool, thread_footprint, false,
+          "Report VMA count, smaps_rollup anon/private memory and the helper "
+          "thread's resident stack every iteration.");
+ABSL_FLAG(bool, task_census, false,
+          "Report thread count, open fd count and thread names every iteration, "
+          "and flag their growth past the warm-up.");
+ABSL_FLAG(bool, heap_counters, false,
+          "Count malloc/new traffic per thread and report allocated, freed and live bytes "
+          "per iteration and phase. Needs a _heapcount binary.");
+ABSL_FLAG(int32_t, heap_profile, 0,
+          "Diff heap profiles from the first and last iteration and report the top N "
+          "growing allocation stacks (needs a _tcmalloc binary, or _jemalloc with "
+          "MALLOC_CONF=prof:true); 0 disables.");
+ABSL_FLAG(int32_t, heap_profile_frames, 4, "Frames shown per stack in --heap_profile.");
+ABSL_FLAG(std::string, results, "text",
+          "Result output: text (human-readable lines), jsonl or csv (one record per phase "
+          "and iteration, buffered per thread and written at the end of the run).");
+ABSL_FLAG(std::string, results_file, "-",
+          "Destination for --results=jsonl|csv; '-' is stdout and suppresses text output.");
+ABSL_FLAG(bool, sweep, false,
+          "Instead of a single run, sweep buffer sizes and thread counts and "
+          "print where RSS stops being returned.");
+ABSL_FLAG(int64_t, sweep_min_kb, 64, "Smallest buffer size in the sweep, in KB.");
+ABSL_FLAG(int64_t, sweep_max_kb, 256 * 1024, "Largest buffer size in the sweep, in KB.");
+ABSL_FLAG(int32_t, sweep_max_threads, 1, "Sweep thread counts 1..N.");
+
+namespace mem_harness {
+
+void apply_flags(HarnessOptions* options) {
+    const std::string load = absl::GetFlag(FLAGS_load);
+    if (load == "closed") {
+        options->load = LoadMode::kClosedLoop;
+    } else if (load == "constant") {
+        options->load = LoadMode::kConstantRate;
+    } else if (load == "poisson") {
+        options->load = LoadMode::kPoisson;
+    } else if (load != "pause") {
+        std::cerr << "Warning: unknown --load '" << load << "', using pause." << std::endl;
+    }
+    options->rate = absl::GetFlag(FLAGS_rate);
+    options->seed = absl::GetFlag(FLAGS_seed);
+    options->duration = std::chrono::seconds(absl::GetFlag(FLAGS_soak_s));
+    options->report_interval = std::chrono::milliseconds(
+        static_cast<int64_t>(absl::GetFlag(FLAGS_report_interval_s) * 1000));
+    if (options->rate <= 0 && options->load != LoadMode::kPause &&
+        options->load != LoadMode::kClosedLoop) {
+        std::cerr << "Warning: --rate must be positive, using closed loop." << std::endl;
+        options->load = LoadMode::kClosedLoop;
+    }
+    options->sample_interval = std::chrono::microseconds(absl::GetFlag(FLAGS_sample_interval_us));
+    options->sample_ring_capacity = absl::GetFlag(FLAGS_sample_ring_capacity);
+    options->max_kept_samples =
+        static_cast<size_t>(std::max(0, absl::GetFlag(FLAGS_max_kept_samples)));
+    options->release_tolerance_kb = absl::GetFlag(FLAGS_release_tolerance_kb);
+    options->report_malloc_stats = absl::GetFlag(FLAGS_malloc_stats);
+    options->report_thread_footprint = absl::GetFlag(FLAGS_thread_footprint);
+    options->report_page_faults = absl::GetFlag(FLAGS_page_faults);
+    options->report_numa = absl::GetFlag(FLAGS_numa_maps);
+    options->report_tasks = absl::GetFlag(FLAGS_task_census);
+    options->report_cgroup = absl::GetFlag(FLAGS_cgroup_stats) ||
+                             absl::GetFlag(FLAGS_cgroup_memory_high_mb) > 0 ||
+                             absl::GetFlag(FLAGS_cgroup_memory_max_mb) > 0;
+    options->record_results = results_enabled();
+    options->leak_warmup_iterations = absl::GetFlag(FLAGS_leak_warmup_iterations);
+    options->leak_threshold_mb = absl::GetFlag(FLAGS_leak_threshold_mb);
+    options->heap_profile_top = absl::GetFlag(FLAGS_heap_profile);
+    options->heap_profile_frames = absl::GetFlag(FLAGS_heap_profile_frames);
+    options->heap_counters = heap_counters_enabled();
+}
+
+void apply_process_flags() {
+    const int64_t high_mb = absl::GetFlag(FLAGS_cgroup_memory_high_mb);
+    const int64_t max_mb = absl::GetFlag(FLAGS_cgroup_memory_max_mb);
+    if (high_mb > 0 || max_mb > 0) {
+        enter_memory_cgroup(high_mb * 1024, max_mb * 1024);
+    }
+
+    MallocTuning tuning;
+    tuning.arena_max = absl::GetFlag(FLAGS_malloc_arena_max);
+    tuning.trim_threshold = absl::GetFlag(FLAGS_malloc_trim_threshold);
+    tuning.mmap_threshold = absl::GetFlag(FLAGS_malloc_mmap_threshold);
+    apply_malloc_tuning(tuning);
+
+    const std::string pool = absl::GetFlag(FLAGS_buffer_pool);
+    BufferPoolMode mode = BufferPoolMode::kNone;
+    if (pool == "global") {
+        mode = BufferPoolMode::kGlobal;
+    } else if (pool == "thread_local") {
+        mode = BufferPoolMode::kThreadLocal;
+        // The per-thread block dies with its thread, so a fresh thread per
+        // job (--io_mode=spawn) would never reuse it.
+        if (absl::GetFlag(FLAGS_io_mode) != "pool") {
+            std::cerr << "Warning: --buffer_pool=thread_local needs long-lived threads; "
+                         "using --io_mode=pool."
+                      << std::endl;
+            absl::SetFlag(&FLAGS_io_mode, "pool");
+        }
+    } else if (pool != "none") {
+        std::cerr << "Warning: unknown --buffer_pool '" << pool << "', using none." << std::endl;
+    }
+    configure_buffer_pool(mode, absl::GetFlag(FLAGS_buffer_huge_pages));
+
+    const std::string thp_name = absl::GetFlag(FLAGS_buffer_thp);
+    ThpPolicy thp = ThpPolicy::kDefault;
+    if (thp_name == "huge") {
+        thp = ThpPolicy::kHuge;
+        if (system_thp_mode() == "never") {
+            std::cerr << "Warning: transparent huge pages are disabled system-wide; "
+                         "--buffer_thp=huge has no effect."
+                      << std::endl;
+        }
+    } else if (thp_name == "nohuge") {
+        thp = ThpPolicy::kNoHuge;
+    } else if (thp_name != "default") {
+        std::cerr << "Warning: unknown --buffer_thp '" << thp_name << "', using default."
+                  << std::endl;
+    }
+    const std::string release_name = absl::GetFlag(FLAGS_buffer_release);
+    ReleasePolicy release = ReleasePolicy::kKeep;
+    if (release_name == "free") {
+        release = ReleasePolicy::kFree;
+    } else if (release_name == "dontneed") {
+        release = ReleasePolicy::kDontNeed;
+    } else if (release_name != "keep") {
+        std::cerr << "Warning: unknown --buffer_release '" << release_name << "', using keep."
+                  << std::endl;
+    }
+    const int node_offset = absl::GetFlag(FLAGS_buffer_node_offset);
+    // A heap buffer shares its pages with other allocations and the policy
+    // outlives free(), so the policies only apply to pool-mapped blocks.
+    if (mode == BufferPoolMode::kNone &&
+        (thp != ThpPolicy::kDefault || release != ReleasePolicy::kKeep || node_offset >= 0)) {
+        std::cerr << "Warning: --buffer_thp, --buffer_release and --buffer_node_offset apply "
+                     "to pooled buffers only; using --buffer_pool=global."
+                  << std::endl;
+        configure_buffer_pool(BufferPoolMode::kGlobal, absl::GetFlag(FLAGS_buffer_huge_pages));
+    }
+    configure_buffer_pages(thp, release);
+    configure_buffer_node(node_offset);
+
+    const std::string engine_name = absl::GetFlag(FLAGS_write_engine);
+    WriteEngine engine = WriteEngine::kStream;
+    if (engine_name == "pwrite") {
+        engine = WriteEngine::kPwrite;
+    } else if (engine_name == "direct") {
+        engine = WriteEngine::kDirect;
+    } else if (engine_name == "uring") {
+        engine = WriteEngine::kUring;
+    } else if (engine_name != "stream") {
+        std::cerr << "Warning: unknown --write_engine '" << engine_name << "', using stream."
+                  << std::endl;
+    }
+    const std::string results = absl::GetFlag(FLAGS_results);
+    ResultFormat format = ResultFormat::kText;
+    if (results == "jsonl") {
+        format = ResultFormat::kJsonLines;
+    } else if (results == "csv") {
+        format = ResultFormat::kCsv;
+    } else if (results != "text") {
+        std::cerr << "Warning: unknown --results '" << results << "', using text." << std::endl;
+    }
+    configure_results(format, absl::GetFlag(FLAGS_results_file));
+
+    if (absl::GetFlag(FLAGS_heap_counters) && !enable_heap_counters()) {
+        std::cerr << "Warning: --heap_counters needs a _heapcount binary (no malloc "
+                     "interposers linked); heap counters disabled."
+                  << std::endl;
+    }
+    if (absl::GetFlag(FLAGS_heap_profile) > 0) {
+        start_heap_profiling();
+    }
+
+    configure_write_engine(engine, static_cast<size_t>(absl::GetFlag(FLAGS_write_chunk_kb)) * 1024,
+                           absl::GetFlag(FLAGS_uring_depth));
+}
+
+ChannelOptions channel_options_from_flags() {
+    ChannelOptions options;
+    options.num_targets = absl::GetFlag(FLAGS_channel_targets);
+    const std::string pool = absl::GetFlag(FLAGS_subchannel_pool);
+    if (pool != "global" && pool != "local") {
+        std::cerr << "Warning: unknown --subchannel_pool '" << pool << "', using global."
+                  << std::endl;
+    }
+    options.local_subchannel_pool = pool == "local";
+    const std::string profile = absl::GetFlag(FLAGS_channel_profile);
+    if (const ChannelProfile* found = find_channel_profile(profile)) {
+        options.profile = *found;
+    } else {
+        std::cerr << "Warning: unknown --channel_profile '" << profile << "', using default."
+                  << std::endl;
+    }
+    return options;
+}
+
+namespace {
+
+// Started on first use so that forked children each run their own server.
+// Never destroyed: shutting it down during static destruction would race
+// gRPC's own teardown.
+EchoServer* echo_server() {
+    static EchoServer* server = EchoServer::start().release();
+    return server;
+}
+
+}  // namespace
+
+ResourceFactory channel_stage() {
+    ChannelOptions options = channel_options_from_flags();
+    if (absl::GetFlag(FLAGS_rpc) && echo_server() != nullptr) {
+        options.target = echo_server()->target();
+    }
+    const std::string mode = absl::GetFlag(FLAGS_channel_mode);
+    if (mode == "cached") {
+        // Shared by every harness in the process, like a service's stub cache.
+        static std::mutex cache_mutex;
+        static std::shared_ptr<ChannelCache> cache;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (!cache) {
+            cache = std::make_shared<ChannelCache>(options);
+        }
+        return cached_channel_churn(cache, options);
+    }
+    if (mode != "per_iteration") {
+        std::cerr << "Warning: unknown --channel_mode '" << mode << "', using per_iteration."
+                  << std::endl;
+    }
+    return channel_churn(options);
+}
+
+void add_channel_stages(Harness* harness) {
+    if (!absl::GetFlag(FLAGS_rpc)) {
+        harness->add_resource_churn("channel", channel_stage());
+        return;
+    }
+    if (echo_server() == nullptr) {
+        // The calls would only fail against the unconnected default target.
+        std::cerr << "Warning: --rpc needs the echo server; running without the RPC workload."
+                  << std::endl;
+        harness->add_resource_churn("channel", channel_stage());
+        return;
+    }
+    RpcOptions rpc_options;
+    rpc_options.message_size = absl::GetFlag(FLAGS_rpc_message_size);
+    rpc_options.rpcs_per_iteration = absl::GetFlag(FLAGS_rpc_per_iteration);
+    rpc_options.streaming = absl::GetFlag(FLAGS_rpc_streaming);
+    rpc_options.outstanding = absl::GetFlag(FLAGS_rpc_outstanding);
+    const std::string api = absl::GetFlag(FLAGS_rpc_api);
+    if (api == "async") {
+        rpc_options.api = RpcApi::kAsync;
+    } else if (api == "callback") {
+        rpc_options.api = RpcApi::kCallback;
+    } else if (api != "sync") {
+        std::cerr << "Warning: unknown --rpc_api '" << api << "', using sync." << std::endl;
+    }
+    if (rpc_options.streaming && rpc_options.api != RpcApi::kSync) {
+        std::cerr << "Warning: --rpc_streaming needs --rpc_api=sync, using unary calls."
+                  << std::endl;
+        rpc_options.streaming = false;
+    }
+    auto rpc = std::make_shared<RpcWorkload>(rpc_options);
+    harness->add_resource_churn("channel", channel_stage(), rpc->use())
+        .add_probe(rpc->probe())
+        .add_report(rpc->report());
+}
+
+bool run_channel_matrix_from_flags(const std::function<bool()>& run) {
+    std::vector<ChannelProfile> profiles;
+    const std::string names = absl::GetFlag(FLAGS_channel_matrix);
+    if (names == "all") {
+        profiles = channel_profiles();
+    } else {
+        for (absl::string_view name : absl::StrSplit(names, ',', absl::SkipEmpty())) {
+            if (const ChannelProfile* found = find_channel_profile(std::string(name))) {
+                profiles.push_back(*found);
+            } else {
+                std::cerr << "Warning: unknown channel profile '" << name << "', skipped."
+                          << std::endl;
+            }
+        }
+    }
+    return run_channel_matrix(profiles, [&run](const ChannelProfile& profile) {
+        absl::SetFlag(&FLAGS_channel_profile, profile.name);
+        return run();
+    });
+}
+
+SweepOptions sweep_options_from_flags() {
+    SweepOptions options;
+    options.min_size = static_cast<size_t>(absl::GetFlag(FLAGS_sweep_min_kb)) * 1024;
+    options.max_size = static_cast<size_t>(absl::GetFlag(FLAGS_sweep_max_kb)) * 1024;
+    options.max_threads = absl::GetFlag(FLAGS_sweep_max_threads);
+    options.release_tolerance_kb = absl::GetFlag(FLAGS_release_tolerance_kb);
+    return options;
+}
+
+void apply_placement(int process_index, int thread_index, int threads_per_process) {
+    const std::string pin = absl::GetFlag(FLAGS_pin);
+    if (pin == "cpu") {
+        pin_thread_to_cpu(process_index * threads_per_process + thread_index);
+    } else if (pin == "node") {
+        pin_thread_to_node(numa_node_at(process_index));
+    } else if (pin != "none") {
+        std::cerr << "Warning: unknown --pin '" << pin << "', using none." << std::endl;
+    }
+}
+
+Stage io_stage(std::function<void(int iteration)> task) {
+    const std::string mode = absl::GetFlag(FLAGS_io_mode);
+    if (mode == "pool") {
+        // Shared by every harness in the process; created lazily so that
+        // forked children build their own workers.
+        static std::mutex pool_mutex;
+        static std::shared_ptr<WorkerPool> pool;
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!pool) {
+            pool = std::make_shared<WorkerPool>(absl::GetFlag(FLAGS_io_pool_size));
+        }
+        return pooled_stage(pool, std::move(task));
+    }
+    if (mode != "spawn") {
+        std::cerr << "Warning: unknown --io_mode '" << mode << "', using spawn." << std::endl;
+    }
+    const size_t stack_size = static_cast<size_t>(absl::GetFlag(FLAGS_io_thread_stack_kb)) * 1024;
+    if (stack_size > 0 || absl::GetFlag(FLAGS_thread_footprint)) {
+        // A pthread, so the stack size can be set and the stack measured.
+        return sized_thread_stage(std::move(task), stack_size);
+    }
+    return spawn_thread_stage(std::move(task));
+}
+
+}  // namespace mem_harness
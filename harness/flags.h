@@ -0,0 +1,137 @@
+#ifndef HARNESS_FLAGS_H_
+#define HARNESS_FLAGS_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "absl/flags/declare.h"
+#include "harness/channels.h"
+#include "harness/harness.h"
+#include "harness/sweep.h"
+
+// Command-line flags shared by every binary linking mem_harness.
+ABSL_DECLARE_FLAG(std::string, load);
+ABSL_DECLARE_FLAG(double, rate);
+ABSL_DECLARE_FLAG(uint64_t, seed);
+ABSL_DECLARE_FLAG(int64_t, soak_s);
+ABSL_DECLARE_FLAG(double, report_interval_s);
+ABSL_DECLARE_FLAG(int64_t, cgroup_memory_high_mb);
+ABSL_DECLARE_FLAG(int64_t, cgroup_memory_max_mb);
+ABSL_DECLARE_FLAG(bool, cgroup_stats);
+ABSL_DECLARE_FLAG(int32_t, sample_interval_us);
+ABSL_DECLARE_FLAG(int32_t, sample_ring_capacity);
+ABSL_DECLARE_FLAG(int32_t, max_kept_samples);
+ABSL_DECLARE_FLAG(int32_t, release_tolerance_kb);
+ABSL_DECLARE_FLAG(bool, malloc_stats);
+ABSL_DECLARE_FLAG(int64_t, malloc_arena_max);
+ABSL_DECLARE_FLAG(int64_t, malloc_trim_threshold);
+ABSL_DECLARE_FLAG(int64_t, malloc_mmap_threshold);
+ABSL_DECLARE_FLAG(std::string, io_mode);
+ABSL_DECLARE_FLAG(int32_t, io_pool_size);
+ABSL_DECLARE_FLAG(std::string, buffer_pool);
+ABSL_DECLARE_FLAG(bool, buffer_huge_pages);
+ABSL_DECLARE_FLAG(std::string, buffer_thp);
+ABSL_DECLARE_FLAG(std::string, buffer_release);
+ABSL_DECLARE_FLAG(bool, page_faults);
+ABSL_DECLARE_FLAG(std::string, pin);
+ABSL_DECLARE_FLAG(int32_t, buffer_node_offset);
+ABSL_DECLARE_FLAG(bool, numa_maps);
+ABSL_DECLARE_FLAG(std::string, write_engine);
+ABSL_DECLARE_FLAG(int32_t, write_chunk_kb);
+ABSL_DECLARE_FLAG(int32_t, uring_depth);
+ABSL_DECLARE_FLAG(std::string, channel_mode);
+ABSL_DECLARE_FLAG(std::string, subchannel_pool);
+ABSL_DECLARE_FLAG(int32_t, channel_targets);
+ABSL_DECLARE_FLAG(std::string, channel_profile);
+ABSL_DECLARE_FLAG(std::string, channel_matrix);
+ABSL_DECLARE_FLAG(bool, rpc);
+ABSL_DECLARE_FLAG(int32_t, rpc_message_size);
+ABSL_DECLARE_FLAG(int32_t, rpc_per_iteration);
+ABSL_DECLARE_FLAG(bool, rpc_streaming);
+ABSL_DECLARE_FLAG(std::string, rpc_api);
+ABSL_DECLARE_FLAG(int32_t, rpc_outstanding);
+ABSL_DECLARE_FLAG(int32_t, leak_warmup_iterations);
+ABSL_DECLARE_FLAG(double, leak_threshold_mb);
+ABSL_DECLARE_FLAG(int32_t, io_thread_stack_kb);
+ABSL_DECLARE_FLAG(bool, thread_footprint);
+ABSL_DECLARE_FLAG(bool, task_census);
+ABSL_DECLARE_FLAG(bool, heap_counters);
+ABSL_DECLARE_FLAG(int32_t, heap_profile);
+ABSL_DECLARE_FLAG(int32_t, heap_profile_frames);
+ABSL_DECLARE_FLAG(std::string, results);
+ABSL_DECLARE_FLAG(std::string, results_file);
+ABSL_DECLARE_FLAG(bool, sweep);
+ABSL_DECLARE_FLAG(int64_t, sweep_min_kb);
+ABSL_DECLARE_FLAG(int64_t, sweep_max_kb);
+ABSL_DECLARE_FLAG(int32_t, sweep_max_threads);
+
+namespace mem_harness {
+
+/**
+ * @brief Overrides the fields of *options that have a corresponding flag.
+ * Call after absl::ParseCommandLine().
+ */
+void apply_flags(HarnessOptions* options);
+
+/**
+ * @brief Applies process-wide flag settings (cgroup memory limits, mallopt
+ * tuning, buffer pool and page policy, write engine, result sink, heap
+ * profiler, heap counters).
+ * Call once from main() after absl::ParseCommandLine(), before spawning any
+ * threads or processes.
+ */
+void apply_process_flags();
+
+/**
+ * @brief Sweep grid from --sweep_min_kb, --sweep_max_kb and --sweep_max_threads.
+ * The sweep itself runs only when --sweep is set.
+ */
+SweepOptions sweep_options_from_flags();
+
+/**
+ * @brief Places the calling thread according to --pin: "cpu" gives thread
+ * thread_index of process process_index its own CPU, "node" puts each
+ * process on one NUMA node (round-robin) with a preferred memory policy.
+ * Threads spawned afterwards inherit the placement.
+ */
+void apply_placement(int process_index, int thread_index, int threads_per_process);
+
+/**
+ * @brief Builds the file I/O workload stage for task according to --io_mode:
+ * "spawn" runs each job on a fresh std::thread, "pool" posts it to a
+ * process-wide WorkerPool of --io_pool_size long-lived workers.
+ */
+Stage io_stage(std::function<void(int iteration)> task);
+
+/**
+ * @brief Channel options from --subchannel_pool, --channel_targets and
+ * --channel_profile.
+ */
+ChannelOptions channel_options_from_flags();
+
+/**
+ * @brief Builds the channel churn stage according to --channel_mode:
+ * "per_iteration" creates a channel and credentials every iteration, "cached"
+ * reuses channels from a process-wide ChannelCache keyed by target.
+ */
+ResourceFactory channel_stage();
+
+/**
+ * @brief Adds the "channel" churn stage to harness. With --rpc the channels
+ * target a process-wide in-process EchoServer and every iteration sends
+ * echo traffic over its channel, reported per iteration and at the end.
+ */
+void add_channel_stages(Harness* harness);
+
+/**
+ * @brief Runs run once per profile named by --channel_matrix ("all" or a
+ * comma-separated list), each in a forked child with --channel_profile set
+ * to that profile, and prints the per-profile table (see run_channel_matrix()).
+ * @return false if any profile failed.
+ */
+bool run_channel_matrix_from_flags(const std::function<bool()>& run);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_FLAGS_H_
@@ -0,0 +1,625 @@
+#include "harness/harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#include "harness/aggregate.h"
+#include "harness/cgroup.h"
+#include "harness/helper_thread.h"
+#include "harness/malloc_stats.h"
+#include "harness/placement.h"
+#include "harness/rss.h"
+#include "harness/task_census.h"
+
+namespace mem_harness {
+
+namespace {
+
+// The Harness whose run() is executing on this thread, for record_latency().
+thread_local Harness* t_current_harness = nullptr;
+
+// "12.0 KB" / "+3.25 MB", in KB below one MB.
+std::string format_bytes(double bytes, bool sign = false) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << (sign ? std::showpos : std::noshowpos);
+    if (std::abs(bytes) < 1024.0 * 1024.0) {
+        out << bytes / 1024.0 << " KB";
+    } else {
+        out << bytes / (1024.0 * 1024.0) << " MB";
+    }
+    return out.str();
+}
+
+// "Heap: alloc 30.01 MB | freed 30.00 MB | live +12.00 KB (write +0.00 KB, ...)"
+std::string format_heap_phases(const std::vector<HeapCounters>& phases_heap,
+                               const std::vector<std::string>& names) {
+    HeapCounters total;
+    for (const HeapCounters& c : phases_heap) {
+        total += c;
+    }
+    std::string text = "Heap: alloc " + format_bytes(total.allocated_bytes) + " | freed " +
+                       format_bytes(total.freed_bytes) + " | live " +
+                       format_bytes(total.live_bytes(), /*sign=*/true) + " (";
+    for (size_t phase = 0; phase < phases_heap.size(); ++phase) {
+        text += (phase == 0 ? "" : ", ") + names[phase] + " " +
+                format_bytes(phases_heap[phase].live_bytes(), /*sign=*/true);
+    }
+    return text + ")";
+}
+
+}  // namespace
+
+Harness::Harness(HarnessOptions options) : options_(std::move(options)) {
+    if (options_.record_results && results_to_stdout()) {
+        options_.quiet = true;
+    }
+    if (options_.report_malloc_stats) {
+        add_probe([](int) {
+            MallocStats stats;
+            if (!capture_malloc_stats(&stats)) {
+                return std::string("Arenas: unavailable");
+            }
+            return format_malloc_stats(stats);
+        });
+    }
+    if (options_.report_page_faults) {
+        add_probe(page_fault_probe());
+    }
+    if (options_.report_numa) {
+        add_probe(numa_probe());
+    }
+    if (options_.report_thread_footprint) {
+        add_probe(thread_footprint_probe());
+    }
+    if (options_.report_cgroup) {
+        auto monitor = std::make_shared<CgroupMonitor>();
+        add_probe(monitor->probe());
+        add_report(monitor->report());
+    }
+    if (options_.report_tasks) {
+        auto tracker = std::make_shared<TaskTracker>(options_.leak_warmup_iterations);
+        add_probe(tracker->probe());
+        add_report(tracker->report());
+    }
+}
+
+int Harness::add_phase(std::string name) {
+    phase_names_.push_back(std::move(name));
+    return static_cast<int>(phase_names_.size()) - 1;
+}
+
+Harness& Harness::add_workload(std::string name, Stage stage) {
+    int phase = add_phase(std::move(name));
+    workloads_.push_back({phase, std::move(stage)});
+    return *this;
+}
+
+Harness& Harness::add_resource_churn(std::string name, ResourceFactory factory,
+                                     ResourceUse use) {
+    int create_phase = add_phase(name + "_create");
+    int use_phase = use ? add_phase(name + "_use") : -1;
+    int destroy_phase = add_phase(name + "_destroy");
+    resource_churn_.push_back(
+        {create_phase, use_phase, destroy_phase, std::move(factory), std::move(use)});
+    return *this;
+}
+
+Harness& Harness::add_probe(Probe probe) {
+    probes_.push_back(std::move(probe));
+    return *this;
+}
+
+Harness& Harness::add_report(Report report) {
+    reports_.push_back(std::move(report));
+    return *this;
+}
+
+void Harness::run() {
+    // Soak iterations are only kept (RSS series, results, spans) once per
+    // series interval, so every buffer is bounded by series_capacity().
+    const size_t capacity = series_capacity(options_);
+    if (options_.sample_interval.count() > 0) {
+        sampler_ = std::make_unique<BackgroundSampler>(options_.sample_interval,
+                                                       options_.sample_ring_capacity);
+        spans_.clear();
+        spans_.reserve(capacity * phase_names_.size());
+        samples_.clear();
+        samples_.reserve(options_.max_kept_samples);
+        samples_discarded_ = 0;
+        sampler_->start();
+    }
+
+    t_current_harness = this;
+    phase_latency_.assign(phase_names_.size(), LatencyHistogram());
+    extra_latency_.clear();
+    // Sub-phase histograms are created on first use, i.e. in iteration 0.
+    run_start_ns_ = now_ns();
+    results_.clear();
+    if (options_.record_results) {
+        // Reserved up front so recording does not grow the heap mid-run.
+        results_.reserve(capacity * (phase_names_.size() + 1));
+    }
+
+    long initial_rss = get_current_rss_kb();
+    if (options_.print_banner && !options_.quiet) {
+        std::lock_guard<std::mutex> lock(output_mutex());
+        std::cout << "PID: " << getpid() << std::endl;
+        std::cout << "Initial RSS: " << std::fixed << std::setprecision(2)
+                  << initial_rss / 1024.0 << " MB" << std::endl;
+        std::cout << "---------------------------------------------------------" << std::endl;
+    }
+
+    // Open-loop schedule: the intended start of the next iteration.
+    std::mt19937_64 rng(options_.seed != 0 ? options_.seed
+                                           : static_cast<uint64_t>(now_ns()) ^
+                                                 reinterpret_cast<uintptr_t>(this));
+    std::exponential_distribution<double> poisson_gap(options_.rate > 0 ? options_.rate : 1);
+    const bool open_loop =
+        options_.load == LoadMode::kConstantRate || options_.load == LoadMode::kPoisson;
+    int64_t scheduled = now_ns();
+
+    const bool soak = options_.duration.count() > 0;
+    const int64_t deadline = run_start_ns_ + std::chrono::nanoseconds(options_.duration).count();
+    const int64_t report_interval_ns = std::chrono::nanoseconds(options_.report_interval).count();
+    int64_t next_report = run_start_ns_;
+    const int64_t series_interval_ns =
+        std::chrono::nanoseconds(series_interval(options_)).count();
+    int64_t next_kept = run_start_ns_;
+    bool previous_kept = false;
+
+    long prev_rss = initial_rss;
+    observed_peak_kb_ = initial_rss;
+    rss_series_.clear();
+    rss_series_.reserve(capacity);
+    iterations_run_ = 0;
+    total_iteration_ns_ = 0;
+    max_iteration_ns_ = 0;
+    if (options_.heap_counters) {
+        run_heap_.assign(phase_names_.size(), HeapCounters());
+    }
+    for (int i = 0; soak ? now_ns() < deadline : i < options_.num_iterations; ++i) {
+        if (open_loop) {
+            int64_t now = now_ns();
+            if (now < scheduled) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(scheduled - now));
+            } else if (i > 0) {
+                // The first iteration starts the schedule, so it has no lag.
+                latency("schedule_lag").record(now - scheduled);
+            }
+            scheduled += options_.load == LoadMode::kPoisson
+                             ? static_cast<int64_t>(poisson_gap(rng) * 1e9)
+                             : static_cast<int64_t>(1e9 / options_.rate);
+        }
+        if (options_.heap_counters) {
+            iteration_heap_.assign(phase_names_.size(), HeapCounters());
+        }
+        int64_t iteration_start = now_ns();
+        keep_iteration_ = !soak || (iteration_start >= next_kept && rss_series_.size() < capacity);
+        run_iteration(i);
+        int64_t iteration_end = now_ns();
+        ++iterations_run_;
+        total_iteration_ns_ += iteration_end - iteration_start;
+        max_iteration_ns_ = std::max(max_iteration_ns_, iteration_end - iteration_start);
+
+        long current_rss = get_current_rss_kb();
+        latency("rss_sample").record(now_ns() - iteration_end);
+        if (options_.record_results && keep_iteration_) {
+            record(kIterationPhase, i, iteration_start, iteration_end, current_rss);
+        }
+        if (iteration_end >= next_report) {
+            if (options_.record_results || options_.quiet) {
+                // No text output, but trackers such as the task census and
+                // the cgroup monitor still take their samples.
+                run_probes(i);
+            } else {
+                report(i, current_rss, initial_rss, prev_rss);
+            }
+            prev_rss = current_rss;
+            next_report = iteration_end + report_interval_ns;
+        }
+        if (keep_iteration_) {
+            rss_series_.push_back(current_rss);
+            next_kept = iteration_start + series_interval_ns;
+        }
+        observed_peak_kb_ = std::max(observed_peak_kb_, current_rss);
+        if (i == 0 && options_.heap_profile_top > 0) {
+            heap_first_ = std::make_unique<HeapSnapshot>();
+            if (!take_heap_snapshot(heap_first_.get())) {
+                heap_first_.reset();
+            }
+        }
+
+        if (sampler_) {
+            // A soak keeps the samples of its kept iterations and of the
+            // iteration after each (releases that land during the pause).
+            int64_t keep_since = 0;
+            if (soak && !keep_iteration_) {
+                keep_since = previous_kept ? 0 : std::numeric_limits<int64_t>::max();
+            } else if (soak) {
+                keep_since = iteration_start;
+            }
+            drain_samples(keep_since);
+        }
+        previous_kept = keep_iteration_;
+        if (options_.load == LoadMode::kPause && options_.pause.count() > 0) {
+            std::this_thread::sleep_for(options_.pause);
+        }
+    }
+    run_end_ns_ = now_ns();
+
+    if (sampler_) {
+        // Keep sampling briefly so releases at the end of the last
+        // iteration are still observed.
+        std::this_thread::sleep_for(options_.sample_interval * 10);
+        sampler_->stop();
+        drain_samples(/*keep_since_ns=*/0);
+        report_phases();
+        sampler_.reset();
+    }
+    check_leak();
+    if (heap_first_) {
+        HeapSnapshot last;
+        if (take_heap_snapshot(&last)) {
+            std::string diff = format_heap_diff(*heap_first_, last, options_.heap_profile_top,
+                                                options_.heap_profile_frames);
+            reports_.push_back([diff] { return diff; });
+        }
+        heap_first_.reset();
+    }
+    if (options_.record_results) {
+        write_results(results_, phase_names_, getpid(), static_cast<pid_t>(syscall(SYS_gettid)));
+    }
+    if (!options_.quiet) {
+        for (const Report& report : reports_) {
+            std::string text = report();
+            std::lock_guard<std::mutex> lock(output_mutex());
+            std::cout << options_.label << text << std::endl;
+        }
+        if (options_.heap_counters) {
+            report_heap_counters();
+        }
+        report_load();
+        report_latency();
+        report_summary();
+    }
+    t_current_harness = nullptr;
+}
+
+void Harness::run_iteration(int iteration) {
+    // --- 1. Workload (Memory Spike) ---
+    for (const auto& stage : workloads_) {
+        int64_t start = begin_phase();
+        stage.run(iteration);
+        mark(stage.phase, iteration, start);
+    }
+    // --- 2. Resource Creation/Closing ---
+    for (const auto& churn : resource_churn_) {
+        int64_t start = begin_phase();
+        Resource resource = churn.create(iteration);
+        mark(churn.create_phase, iteration, start);
+
+        if (churn.use) {
+            start = begin_phase();
+            churn.use(resource, iteration);
+            mark(churn.use_phase, iteration, start);
+        }
+
+        start = begin_phase();
+        resource.reset();
+        mark(churn.destroy_phase, iteration, start);
+    }
+}
+
+int64_t Harness::begin_phase() {
+    if (options_.heap_counters) {
+        phase_heap_start_ = thread_heap_counters();
+    }
+    return now_ns();
+}
+
+void Harness::mark(int phase, int iteration, int64_t start_ns) {
+    if (options_.heap_counters) {
+        HeapCounters delta = thread_heap_counters() - phase_heap_start_;
+        iteration_heap_[phase] += delta;
+        run_heap_[phase] += delta;
+    }
+    int64_t end_ns = now_ns();
+    phase_latency_[phase].record(end_ns - start_ns);
+    if (!keep_iteration_) {
+        return;
+    }
+    if (sampler_) {
+        spans_.push_back({phase, iteration, start_ns, end_ns});
+    }
+    if (options_.record_results) {
+        record(phase, iteration, start_ns, end_ns, get_current_rss_kb());
+    }
+}
+
+void Harness::record(int phase, int iteration, int64_t start_ns, int64_t end_ns, long rss_kb) {
+    results_.push_back({iteration, phase, rss_kb, end_ns - run_start_ns_, end_ns - start_ns});
+}
+
+std::string Harness::run_probes(int iteration) {
+    std::string probe_text;
+    for (const Probe& probe : probes_) {
+        std::string text = probe(iteration);
+        if (!text.empty()) {
+            probe_text += " | " + text;
+        }
+    }
+    return probe_text;
+}
+
+void Harness::report(int iteration, long current_rss, long initial_rss, long prev_rss) {
+    double diff_from_start = (current_rss - initial_rss) / 1024.0;
+    double diff_from_last = (current_rss - prev_rss) / 1024.0;
+
+    // Probes run before taking the output lock so they never serialize threads.
+    std::string probe_text = run_probes(iteration);
+
+    if (options_.heap_counters) {
+        probe_text += " | " + format_heap_phases(iteration_heap_, phase_names_);
+    }
+
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << "Iteration " << iteration + 1;
+    if (options_.duration.count() > 0) {
+        std::cout << " at " << std::fixed << std::setprecision(1)
+                  << (now_ns() - run_start_ns_) / 1e9 << "/" << options_.duration.count() << " s";
+    } else {
+        std::cout << "/" << options_.num_iterations;
+    }
+    std::cout << ": " << std::fixed << std::setprecision(2)
+              << "Current RSS: " << current_rss / 1024.0 << " MB | "
+              << "Total increase: " << std::showpos << diff_from_start << " MB";
+    // Skip deltas that round to zero at the printed precision.
+    if (std::abs(diff_from_last) >= 0.005) {
+        std::cout << " | Delta: " << diff_from_last << " MB";
+    }
+    std::cout << std::noshowpos << probe_text << std::endl;
+}
+
+void Harness::report_phases() {
+    // Tolerates a few samples lost to a full ring or a late wakeup.
+    const int64_t max_gap_ns =
+        4 * std::chrono::duration_cast<std::chrono::nanoseconds>(options_.sample_interval).count();
+    std::vector<PhaseSummary> summaries =
+        summarize_phases(samples_, spans_, phase_names_, options_.release_tolerance_kb,
+                         max_gap_ns, /*truncated=*/samples_discarded_ > 0);
+
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << "Phase summary (" << samples_.size() << " samples every "
+              << options_.sample_interval.count() << " us, " << sampler_->dropped()
+              << " dropped";
+    if (samples_discarded_ > 0) {
+        std::cout << ", " << samples_discarded_ << " past --max_kept_samples";
+    }
+    std::cout << "):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const PhaseSummary& s : summaries) {
+        std::cout << options_.label << "  " << std::left << std::setw(18) << s.name << std::right
+                  << " runs: " << s.occurrences
+                  << " | Peak RSS: " << s.peak_rss_kb / 1024.0 << " MB"
+                  << " | Max rise: " << s.max_rise_kb / 1024.0 << " MB"
+                  << " | Release: mean " << s.mean_release_ms << " ms, max "
+                  << s.max_release_ms << " ms"
+                  << " | Unreleased: " << s.unreleased;
+        if (s.skipped > 0) {
+            std::cout << " | Not covered: " << s.skipped;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void Harness::check_leak() {
+    size_t n = rss_series_.size();
+    // In a soak each entry stands for one series interval of iterations;
+    // the slope and warm-up are still given per iteration.
+    const bool soak = series_interval(options_).count() > 0;
+    const double per_entry = soak && n > 0 ? static_cast<double>(iterations_run_) / n : 1;
+    size_t warmup = options_.leak_warmup_iterations < 0
+                        ? n / 2
+                        : std::min(n, static_cast<size_t>(options_.leak_warmup_iterations /
+                                                          std::max(per_entry, 1.0)));
+    SlopeFit fit = fit_slope(rss_series_, warmup);
+    fit.slope /= per_entry;
+    fit.stderr_slope /= per_entry;
+    double slope_mb = fit.slope / 1024.0;
+    passed_ = options_.leak_threshold_mb <= 0 || slope_mb <= options_.leak_threshold_mb;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4) << "Leak check: slope " << std::showpos << slope_mb
+        << std::noshowpos << " MB/iteration";
+    if (fit.points > 2) {
+        out << " (95% CI +/- " << t_critical_95(fit.points - 2) * fit.stderr_slope / 1024.0 << ")";
+    }
+    if (soak) {
+        out << " over samples " << warmup + 1 << "-" << n << " (one per "
+            << series_interval(options_).count() << " ms, " << iterations_run_ << " iterations)";
+    } else {
+        out << " over iterations " << warmup + 1 << "-" << n;
+    }
+    if (options_.leak_threshold_mb > 0) {
+        out << " | threshold " << options_.leak_threshold_mb << ": " << (passed_ ? "PASS" : "FAIL");
+    }
+    leak_text_ = out.str();
+}
+
+void Harness::report_heap_counters() {
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << "Thread heap by phase:" << std::endl;
+    for (size_t phase = 0; phase < run_heap_.size(); ++phase) {
+        const HeapCounters& c = run_heap_[phase];
+        std::cout << options_.label << "  " << std::left << std::setw(18) << phase_names_[phase]
+                  << std::right << " allocs: " << c.allocations << " ("
+                  << format_bytes(c.allocated_bytes) << ") | frees: " << c.frees << " ("
+                  << format_bytes(c.freed_bytes) << ") | live: "
+                  << format_bytes(c.live_bytes(), /*sign=*/true) << std::endl;
+    }
+}
+
+LatencyHistogram& Harness::latency(const char* name) {
+    for (auto& [extra_name, histogram] : extra_latency_) {
+        if (extra_name == name) {
+            return *histogram;
+        }
+    }
+    extra_latency_.emplace_back(name, std::make_unique<LatencyHistogram>());
+    return *extra_latency_.back().second;
+}
+
+void Harness::report_load() {
+    static const char* const kNames[] = {"pause", "closed-loop", "constant", "poisson"};
+    double seconds = (run_end_ns_ - run_start_ns_) / 1e9;
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << "Load: " << kNames[static_cast<int>(options_.load)]
+              << std::fixed << std::setprecision(2);
+    if (options_.load == LoadMode::kConstantRate || options_.load == LoadMode::kPoisson) {
+        std::cout << " at " << options_.rate << "/s target";
+    }
+    std::cout << " | achieved " << (seconds > 0 ? iterations_run_ / seconds : 0.0)
+              << " iterations/s over " << seconds << " s" << std::endl;
+}
+
+void Harness::report_latency() {
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << "Latency per phase:" << std::endl;
+    auto print = [this](const std::string& name, const LatencyHistogram& histogram) {
+        std::cout << options_.label << "  " << std::left << std::setw(18) << name << std::right
+                  << " n: " << histogram.count() << " | " << format_percentiles(histogram)
+                  << std::endl;
+    };
+    for (size_t phase = 0; phase < phase_latency_.size(); ++phase) {
+        print(phase_names_[phase], phase_latency_[phase]);
+    }
+    for (const auto& [name, histogram] : extra_latency_) {
+        print(name, *histogram);
+    }
+}
+
+void Harness::drain_samples(int64_t keep_since_ns) {
+    sampler_->drain([this, keep_since_ns](const TimedSample& sample) {
+        observed_peak_kb_ = std::max(observed_peak_kb_, sample.memory.rss_kb);
+        if (sample.t_ns < keep_since_ns) {
+            return;
+        }
+        if (samples_.size() < options_.max_kept_samples) {
+            samples_.push_back(sample);
+        } else {
+            ++samples_discarded_;
+        }
+    });
+}
+
+void Harness::report_summary() {
+    long steady = 0;
+    if (!rss_series_.empty()) {
+        size_t begin = rss_series_.size() / 2;
+        long long sum = 0;
+        for (size_t i = begin; i < rss_series_.size(); ++i) {
+            sum += rss_series_[i];
+        }
+        steady = sum / static_cast<long long>(rss_series_.size() - begin);
+    }
+    long final_rss = rss_series_.empty() ? get_current_rss_kb() : rss_series_.back();
+
+    double mean_ms = iterations_run_ > 0 ? total_iteration_ns_ / 1e6 / iterations_run_ : 0;
+    double max_ms = max_iteration_ns_ / 1e6;
+
+    std::lock_guard<std::mutex> lock(output_mutex());
+    std::cout << options_.label << leak_text_ << std::endl;
+    std::cout << options_.label << "Summary: steady_rss_kb=" << steady
+              << " final_rss_kb=" << final_rss
+              << " peak_rss_kb=" << observed_peak_rss_kb({observed_peak_kb_, final_rss})
+              << std::fixed << std::setprecision(3)
+              << " mean_iteration_ms=" << mean_ms
+              << " max_iteration_ms=" << max_ms << std::endl;
+}
+
+void record_latency(const char* name, int64_t ns) {
+    if (t_current_harness != nullptr) {
+        t_current_harness->latency(name).record(ns);
+    }
+}
+
+std::chrono::milliseconds series_interval(const HarnessOptions& options) {
+    if (options.duration.count() <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+    return options.report_interval.count() > 0 ? options.report_interval
+                                               : std::chrono::milliseconds(1000);
+}
+
+size_t series_capacity(const HarnessOptions& options) {
+    const std::chrono::milliseconds interval = series_interval(options);
+    if (interval.count() == 0) {
+        return static_cast<size_t>(std::max(options.num_iterations, 0));
+    }
+    // One entry at the start and one per full interval after it.
+    return static_cast<size_t>(std::chrono::milliseconds(options.duration).count() /
+                               interval.count()) + 1;
+}
+
+std::mutex& output_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+Stage spawn_thread_stage(std::function<void(int iteration)> task) {
+    return [task = std::move(task)](int iteration) {
+        // Offload the task to a separate thread and wait for it to finish.
+        // This ensures memory allocated inside the task is released before
+        // the next iteration (unless a leak occurs).
+        HeapCounters worker;
+        int64_t started = 0, finished = 0;
+        int64_t spawn = now_ns();
+        std::thread t([&task, &worker, &started, &finished, iteration] {
+            started = now_ns();
+            task(iteration);
+            worker = thread_heap_counters();
+            finished = now_ns();
+        });
+        t.join();
+        int64_t joined = now_ns();
+        absorb_heap_counters(worker);
+        record_latency("thread_spawn", started - spawn);
+        record_latency("thread_join", joined - finished);
+    };
+}
+
+Probe page_fault_probe() {
+    return [last = get_fault_counts()](int) mutable {
+        FaultCounts now = get_fault_counts();
+        std::ostringstream out;
+        out << "Faults: " << now.minor - last.minor << " minor, " << now.major - last.major
+            << " major";
+        last = now;
+        return out.str();
+    };
+}
+
+Probe rss_breakdown_probe() {
+    return [](int) {
+        MemorySample sample;
+        if (!sample_memory(&sample)) {
+            return std::string();
+        }
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2)
+            << "Anon: " << sample.anon_kb / 1024.0 << " MB | "
+            << "File: " << sample.file_kb / 1024.0 << " MB";
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
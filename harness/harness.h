@@ -0,0 +1,338 @@
+#ifndef HARNESS_HARNESS_H_
+#define HARNESS_HARNESS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "harness/heap_counters.h"
+#include "harness/heap_profile.h"
+#include "harness/histogram.h"
+#include "harness/results.h"
+#include "harness/sampler.h"
+
+namespace mem_harness {
+
+/**
+ * @brief A unit of work run once per iteration of the harness loop.
+ * @param iteration Zero-based iteration index.
+ */
+using Stage = std::function<void(int iteration)>;
+
+/**
+ * @brief Type-erased handle to a resource created by a churn stage. The
+ * harness releases it in a separate, separately measured phase.
+ */
+using Resource = std::shared_ptr<void>;
+
+/**
+ * @brief Creates the resource for one iteration (e.g. a gRPC channel).
+ */
+using ResourceFactory = std::function<Resource(int iteration)>;
+
+/**
+ * @brief Exercises a churned resource between its create and destroy phases
+ * (e.g. sends RPCs over the channel).
+ */
+using ResourceUse = std::function<void(const Resource& resource, int iteration)>;
+
+/**
+ * @brief Extra measurement taken after each iteration's RSS sample. A
+ * non-empty result is appended to that iteration's output line.
+ */
+using Probe = std::function<std::string(int iteration)>;
+
+/**
+ * @brief End-of-run report line printed after the last iteration.
+ */
+using Report = std::function<std::string()>;
+
+/**
+ * @brief How iterations are paced.
+ */
+enum class LoadMode {
+    // Sleep HarnessOptions::pause after every iteration (the original loop).
+    kPause,
+    // Start the next iteration as soon as the previous one returns.
+    kClosedLoop,
+    // Open loop: iterations are scheduled at fixed 1/rate intervals.
+    kConstantRate,
+    // Open loop: exponentially distributed gaps with mean 1/rate.
+    kPoisson,
+};
+
+/**
+ * @brief Loop configuration shared by every test-mem-leak binary.
+ */
+struct HarnessOptions {
+    // Number of iterations in the main loop.
+    int num_iterations = 50;
+    // Soak: when non-zero, iterate until this much time has passed instead
+    // of num_iterations.
+    std::chrono::seconds duration{0};
+    // Print at most one per-iteration line (and run the probes once) per
+    // interval; zero reports every iteration. Meant for long soaks, which
+    // also keep one RSS sample per interval (see series_interval()).
+    std::chrono::milliseconds report_interval{0};
+    // Sleep after every iteration to mimic a real-world processing pause.
+    std::chrono::milliseconds pause{0};
+    // Iteration pacing; the open-loop modes ignore pause and use rate.
+    LoadMode load = LoadMode::kPause;
+    // Target iterations per second for the open-loop modes.
+    double rate = 10;
+    // Seed for the Poisson schedule; zero seeds from the clock.
+    uint64_t seed = 0;
+    // Prefix for every per-iteration line, e.g. "PID: 42 TID: 0 ".
+    std::string label;
+    // Print the PID / initial RSS banner before the first iteration.
+    bool print_banner = true;
+    // Suppress the banner, per-iteration lines and summary (e.g. in a sweep).
+    bool quiet = false;
+    // Background sampling interval; zero disables the sampler thread.
+    std::chrono::microseconds sample_interval{0};
+    // Capacity of the sampler ring, in samples.
+    size_t sample_ring_capacity = 1 << 16;
+    // Most sampler samples kept for the phase summary; later ones only
+    // update the observed peak. Reserved up front.
+    size_t max_kept_samples = 1 << 18;
+    // Slack above the pre-phase RSS that still counts as released.
+    long release_tolerance_kb = 1024;
+    // Append glibc arena usage (malloc_info) to every iteration line.
+    bool report_malloc_stats = false;
+    // Append VMA count, smaps_rollup anon/private memory and the helper
+    // thread's stack footprint to every iteration line.
+    bool report_thread_footprint = false;
+    // Append the process's minor/major page faults during each iteration.
+    bool report_page_faults = false;
+    // Append the process's thread and open fd counts, naming threads that
+    // came or went, and report their growth past the warm-up at the end.
+    bool report_tasks = false;
+    // Append the current cgroup's memory, reclaim, limit events and
+    // pressure (PSI), and report their totals at the end.
+    bool report_cgroup = false;
+    // Append resident memory per NUMA node (/proc/self/numa_maps).
+    bool report_numa = false;
+    // Buffer one ResultRecord per phase and per iteration and hand them to
+    // write_results() at the end of run(). Replaces the per-iteration text
+    // lines; with results on stdout all text output is suppressed.
+    bool record_results = false;
+    // Iterations excluded from the leak-slope fit; negative means the first half.
+    int leak_warmup_iterations = -1;
+    // Fail the leak check when the fitted slope exceeds this many MB per
+    // iteration; zero only reports the slope.
+    double leak_threshold_mb = 0;
+    // Snapshot the allocator's heap profile after the first and the last
+    // iteration and report this many stacks that grew the most; zero disables.
+    int heap_profile_top = 0;
+    // Frames shown per reported stack.
+    int heap_profile_frames = 4;
+    // Append this thread's heap traffic per iteration, split by phase, and
+    // report per-phase totals at the end. Needs enable_heap_counters().
+    bool heap_counters = false;
+};
+
+/**
+ * @brief The iteration loop: runs the workload stages, then the resource
+ * churn stages, then samples RSS and reports the total and per-iteration delta.
+ *
+ * Every stage is a phase; a churn stage contributes a "<name>_create" and a
+ * "<name>_destroy" phase, plus "<name>_use" when it has a use step. With a
+ * sample interval set, a background sampler records memory throughout and
+ * run() ends with the per-phase peak and time-to-release.
+ *
+ * run() always ends with a single machine-parsable "Summary:" line carrying
+ * the steady-state RSS (mean over the second half of the iterations), the
+ * final RSS and the process peak RSS, all in KB, followed by the mean and
+ * max iteration latency (stages only, excluding the pause) in ms. It is
+ * preceded by a "Leak check:" line with the least-squares RSS slope past the
+ * warm-up and, with a threshold set, a PASS/FAIL verdict (see passed()).
+ * Before it, a latency table gives p50/p90/p99/max for every phase and for
+ * sub-phases recorded with record_latency() (thread spawn and join, RSS
+ * sampling). In the open-loop modes an iteration that cannot start on
+ * schedule starts late rather than being skipped; the lateness is recorded
+ * as "schedule_lag", and a "Load:" line compares target and achieved rates.
+ *
+ * With a duration set the loop runs for that long instead (a soak), and
+ * with a report interval the per-iteration lines are downsampled to one per
+ * interval; probes then report changes over the whole interval. A soak also
+ * keeps its buffers bounded: the RSS series, recorded results and phase
+ * spans only cover one iteration per series_interval().
+ *
+ * Output lines are serialized through output_mutex() so several harnesses
+ * may run concurrently inside one process. Recorded results are buffered
+ * per harness, i.e. per thread, and take no lock until the run ends.
+ */
+class Harness {
+ public:
+    explicit Harness(HarnessOptions options);
+
+    /**
+     * @brief Adds a stage that produces the memory spike (e.g. file I/O).
+     */
+    Harness& add_workload(std::string name, Stage stage);
+
+    /**
+     * @brief Adds a stage that creates and releases a resource (e.g. a gRPC
+     * channel), optionally exercising it in between.
+     */
+    Harness& add_resource_churn(std::string name, ResourceFactory factory,
+                                ResourceUse use = nullptr);
+
+    /**
+     * @brief Adds a measurement reported alongside RSS every iteration (or
+     * report interval). Probes also run, unprinted, with quiet output or
+     * recorded results, so trackers keep sampling.
+     */
+    Harness& add_probe(Probe probe);
+
+    /**
+     * @brief Adds a line printed once after the last iteration.
+     */
+    Harness& add_report(Report report);
+
+    /**
+     * @brief Runs all iterations on the calling thread.
+     */
+    void run();
+
+    /**
+     * @brief RSS in KB sampled after each completed iteration, or in a soak
+     * after one iteration per series_interval().
+     */
+    const std::vector<long>& rss_series() const { return rss_series_; }
+
+    /**
+     * @brief Iterations completed by the last run().
+     */
+    int64_t iterations_run() const { return iterations_run_; }
+
+    /**
+     * @brief False if the last run's leak slope exceeded the threshold.
+     * Binaries turn this into a non-zero exit code.
+     */
+    bool passed() const { return passed_; }
+
+ private:
+    struct NamedStage {
+        int phase;
+        Stage run;
+    };
+    struct NamedChurn {
+        int create_phase;
+        int use_phase;
+        int destroy_phase;
+        ResourceFactory create;
+        ResourceUse use;
+    };
+
+    int add_phase(std::string name);
+    void run_iteration(int iteration);
+    friend void record_latency(const char* name, int64_t ns);
+
+    LatencyHistogram& latency(const char* name);
+    int64_t begin_phase();
+    void mark(int phase, int iteration, int64_t start_ns);
+    void record(int phase, int iteration, int64_t start_ns, int64_t end_ns, long rss_kb);
+    // Runs every probe; returns " | <text>" per non-empty result.
+    std::string run_probes(int iteration);
+    // All RSS values are in KB.
+    void report(int iteration, long current_rss, long initial_rss, long prev_rss);
+    void report_phases();
+    void report_heap_counters();
+    void report_latency();
+    void report_load();
+    void check_leak();
+    void report_summary();
+    // Pops the sampler's ring, folding every sample's RSS into
+    // observed_peak_kb_ and appending those taken at or after keep_since_ns
+    // to samples_ until it holds max_kept_samples, so samples_ never grows
+    // past its up-front reservation.
+    void drain_samples(int64_t keep_since_ns);
+
+    HarnessOptions options_;
+    std::vector<std::string> phase_names_;
+    std::vector<NamedStage> workloads_;
+    std::vector<NamedChurn> resource_churn_;
+    std::vector<Probe> probes_;
+    std::vector<Report> reports_;
+    std::vector<long> rss_series_;
+    // Highest RSS seen in rss_series_ or the sampler; ru_maxrss can lag
+    // behind the statm values those are read from.
+    long observed_peak_kb_ = 0;
+    int64_t iterations_run_ = 0;
+    int64_t total_iteration_ns_ = 0;
+    int64_t max_iteration_ns_ = 0;
+    // False for the soak iterations that record no results or spans.
+    bool keep_iteration_ = true;
+    int64_t run_start_ns_ = 0;
+    int64_t run_end_ns_ = 0;
+    bool passed_ = true;
+    std::unique_ptr<HeapSnapshot> heap_first_;
+    // Heap counters at the start of the current phase, and per-phase deltas
+    // for the current iteration and the whole run.
+    HeapCounters phase_heap_start_;
+    std::vector<HeapCounters> iteration_heap_;
+    std::vector<HeapCounters> run_heap_;
+    // Indexed like phase_names_; extra_latency_ holds named sub-phases.
+    std::vector<LatencyHistogram> phase_latency_;
+    std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> extra_latency_;
+    std::string leak_text_;
+    std::vector<ResultRecord> results_;
+
+    std::unique_ptr<BackgroundSampler> sampler_;
+    std::vector<TimedSample> samples_;
+    // Samples not kept because samples_ was full.
+    uint64_t samples_discarded_ = 0;
+    std::vector<PhaseSpan> spans_;
+};
+
+/**
+ * @brief Adds a sub-phase latency to the histogram `name` of the Harness
+ * currently running on this thread; a no-op outside Harness::run(). Meant
+ * for stages that time their own steps, e.g. thread spawn and join.
+ */
+void record_latency(const char* name, int64_t ns);
+
+/**
+ * @brief Spacing of rss_series() entries in a soak: the report interval, or
+ * one second without one. Zero outside a soak (one entry per iteration).
+ */
+std::chrono::milliseconds series_interval(const HarnessOptions& options);
+
+/**
+ * @brief Upper bound on rss_series().size() for a run with options.
+ */
+size_t series_capacity(const HarnessOptions& options);
+
+/**
+ * @brief Mutex guarding std::cout for all harness output in this process.
+ */
+std::mutex& output_mutex();
+
+/**
+ * @brief Wraps a task so that each iteration runs it on a freshly spawned
+ * std::thread and joins it, matching the original repro pattern.
+ */
+Stage spawn_thread_stage(std::function<void(int iteration)> task);
+
+/**
+ * @brief Probe with the process page faults since the previous call, e.g.
+ * "Faults: 7681 minor, 0 major".
+ */
+Probe page_fault_probe();
+
+/**
+ * @brief Probe splitting RSS into anonymous and file-backed memory, e.g.
+ * "Anon: 40.10 MB | File: 35.02 MB".
+ */
+Probe rss_breakdown_probe();
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_HARNESS_H_
@@ -0,0 +1,67 @@
+#include "harness/heap_counters.h"
+
+#include <atomic>
+
+namespace mem_harness {
+
+namespace {
+
+std::atomic<bool> g_interposed{false};
+std::atomic<bool> g_enabled{false};
+
+__attribute__((tls_model("initial-exec"))) thread_local HeapCounters t_counters;
+
+}  // namespace
+
+HeapCounters& HeapCounters::operator+=(const HeapCounters& other) {
+    allocated_bytes += other.allocated_bytes;
+    freed_bytes += other.freed_bytes;
+    allocations += other.allocations;
+    frees += other.frees;
+    return *this;
+}
+
+HeapCounters HeapCounters::operator-(const HeapCounters& other) const {
+    HeapCounters delta;
+    delta.allocated_bytes = allocated_bytes - other.allocated_bytes;
+    delta.freed_bytes = freed_bytes - other.freed_bytes;
+    delta.allocations = allocations - other.allocations;
+    delta.frees = frees - other.frees;
+    return delta;
+}
+
+bool enable_heap_counters() {
+    if (!g_interposed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    g_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool heap_counters_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+HeapCounters thread_heap_counters() {
+    return t_counters;
+}
+
+void absorb_heap_counters(const HeapCounters& counters) {
+    t_counters += counters;
+}
+
+void register_heap_interposers() {
+    g_interposed.store(true, std::memory_order_relaxed);
+}
+
+void count_heap_alloc(size_t usable_size) {
+    t_counters.allocated_bytes += usable_size;
+    ++t_counters.allocations;
+}
+
+void count_heap_free(size_t usable_size) {
+    t_counters.freed_bytes += usable_size;
+    ++t_counters.frees;
+}
+
+}  // namespace mem_harness
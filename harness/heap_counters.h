@@ -0,0 +1,69 @@
+#ifndef HARNESS_HEAP_COUNTERS_H_
+#define HARNESS_HEAP_COUNTERS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mem_harness {
+
+/**
+ * @brief Heap traffic counted on one thread. Sizes are the allocator's
+ * usable sizes, so a block counts the same when allocated and when freed.
+ */
+struct HeapCounters {
+    uint64_t allocated_bytes = 0;
+    uint64_t freed_bytes = 0;
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+
+    // Bytes allocated minus bytes freed on this thread. Negative when the
+    // thread frees blocks another thread allocated.
+    int64_t live_bytes() const {
+        return static_cast<int64_t>(allocated_bytes) - static_cast<int64_t>(freed_bytes);
+    }
+
+    HeapCounters& operator+=(const HeapCounters& other);
+    HeapCounters operator-(const HeapCounters& other) const;
+};
+
+/**
+ * @brief Starts counting in the malloc/free and operator new/delete
+ * interposers. Counting is off by default and the interposers then only
+ * forward to the linked allocator. Call before spawning threads.
+ * @return false, counting nothing, if the binary was not linked with
+ * :heap_interpose (the _heapcount variants are).
+ */
+bool enable_heap_counters();
+
+bool heap_counters_enabled();
+
+/**
+ * @brief The calling thread's counters since it started, plus anything
+ * absorbed from joined workers. Lock-free: reads a thread_local.
+ */
+HeapCounters thread_heap_counters();
+
+/**
+ * @brief Credits a worker thread's counters to the calling thread, so work
+ * offloaded by spawn_thread_stage() or a WorkerPool is attributed to the
+ * harness thread and phase that requested it.
+ */
+void absorb_heap_counters(const HeapCounters& counters);
+
+// --- Hooks for the interposers in :heap_interpose ---
+
+/**
+ * @brief Marks the interposers as linked; called before main().
+ */
+void register_heap_interposers();
+
+/**
+ * @brief Adds one allocated or freed block of usable_size bytes to the
+ * calling thread's counters.
+ */
+void count_heap_alloc(size_t usable_size);
+void count_heap_free(size_t usable_size);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_HEAP_COUNTERS_H_
@@ -0,0 +1,309 @@
+// malloc/free and operator new/delete interposers feeding the heap
+// counters. Linked only into the _heapcount binaries (:heap_interpose), so
+// the plain binaries measure the allocator without an extra call layer.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <new>
+#include <unistd.h>
+
+#include "harness/heap_counters.h"
+
+namespace mem_harness {
+
+namespace {
+
+// The linked allocator's entry points (glibc, jemalloc, tcmalloc or
+// mimalloc), looked up past this executable's interposers.
+struct RealAllocator {
+    void* (*malloc)(size_t);
+    void (*free)(void*);
+    void* (*calloc)(size_t, size_t);
+    void* (*realloc)(void*, size_t);
+    int (*posix_memalign)(void**, size_t, size_t);
+    void* (*aligned_alloc)(size_t, size_t);
+    void* (*memalign)(size_t, size_t);
+    void* (*valloc)(size_t);
+    size_t (*malloc_usable_size)(void*);
+};
+
+RealAllocator g_real;
+std::atomic<bool> g_resolved{false};
+
+__attribute__((tls_model("initial-exec"))) thread_local bool t_resolving = false;
+
+// dlsym() itself may allocate; those requests are served from here and never freed.
+alignas(16) char g_bootstrap[64 * 1024];
+std::atomic<size_t> g_bootstrap_used{0};
+
+constexpr size_t kBootstrapHeader = 16;
+
+bool is_bootstrap(const void* ptr) {
+    return ptr >= g_bootstrap && ptr < g_bootstrap + sizeof(g_bootstrap);
+}
+
+void* bootstrap_alloc(size_t size) {
+    size_t need = kBootstrapHeader + ((size + 15) & ~static_cast<size_t>(15));
+    size_t offset = g_bootstrap_used.fetch_add(need);
+    if (offset + need > sizeof(g_bootstrap)) {
+        return nullptr;
+    }
+    std::memcpy(g_bootstrap + offset, &size, sizeof(size));
+    return g_bootstrap + offset + kBootstrapHeader;
+}
+
+size_t bootstrap_size(const void* ptr) {
+    size_t size;
+    std::memcpy(&size, static_cast<const char*>(ptr) - kBootstrapHeader, sizeof(size));
+    return size;
+}
+
+template <typename F>
+void lookup(F* target, const char* name) {
+    *target = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+}
+
+// Returns false while another lookup is in progress on this thread.
+bool resolve() {
+    if (g_resolved.load(std::memory_order_acquire)) {
+        return true;
+    }
+    if (t_resolving) {
+        return false;
+    }
+    t_resolving = true;
+    RealAllocator real;
+    lookup(&real.malloc, "malloc");
+    lookup(&real.free, "free");
+    lookup(&real.calloc, "calloc");
+    lookup(&real.realloc, "realloc");
+    lookup(&real.posix_memalign, "posix_memalign");
+    lookup(&real.aligned_alloc, "aligned_alloc");
+    lookup(&real.memalign, "memalign");
+    lookup(&real.valloc, "valloc");
+    lookup(&real.malloc_usable_size, "malloc_usable_size");
+    g_real = real;
+    g_resolved.store(true, std::memory_order_release);
+    t_resolving = false;
+    return true;
+}
+
+// Resolve before main() so the lookup happens single-threaded, and let
+// enable_heap_counters() know the interposers are in.
+__attribute__((constructor(101))) void resolve_early() {
+    resolve();
+    register_heap_interposers();
+}
+
+inline void count_alloc(void* ptr) {
+    if (ptr != nullptr && heap_counters_enabled()) {
+        count_heap_alloc(g_real.malloc_usable_size(ptr));
+    }
+}
+
+inline void count_free(void* ptr) {
+    if (heap_counters_enabled()) {
+        count_heap_free(g_real.malloc_usable_size(ptr));
+    }
+}
+
+}  // namespace
+
+}  // namespace mem_harness
+
+// --- Interposers ---
+// Defined in the executable, these take precedence over the allocator for
+// every library in the process (including gRPC core's gpr_malloc).
+
+using mem_harness::bootstrap_alloc;
+using mem_harness::bootstrap_size;
+using mem_harness::count_alloc;
+using mem_harness::count_free;
+using mem_harness::g_real;
+using mem_harness::is_bootstrap;
+using mem_harness::resolve;
+
+extern "C" {
+
+void* malloc(size_t size) {
+    if (!resolve()) {
+        return bootstrap_alloc(size);
+    }
+    void* ptr = g_real.malloc(size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void free(void* ptr) {
+    if (ptr == nullptr || is_bootstrap(ptr) || !resolve()) {
+        return;
+    }
+    count_free(ptr);
+    g_real.free(ptr);
+}
+
+void* calloc(size_t count, size_t size) {
+    if (!resolve()) {
+        // Bootstrap memory is static and therefore already zeroed.
+        return bootstrap_alloc(count * size);
+    }
+    void* ptr = g_real.calloc(count, size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!resolve()) {
+        return bootstrap_alloc(size);
+    }
+    if (is_bootstrap(ptr)) {
+        void* moved = malloc(size);
+        if (moved != nullptr) {
+            size_t old_size = bootstrap_size(ptr);
+            std::memcpy(moved, ptr, old_size < size ? old_size : size);
+        }
+        return moved;
+    }
+    if (ptr != nullptr) {
+        count_free(ptr);
+    }
+    void* moved = g_real.realloc(ptr, size);
+    if (moved != nullptr) {
+        count_alloc(moved);
+    } else if (ptr != nullptr && size != 0) {
+        // Failed realloc keeps the old block live.
+        count_alloc(ptr);
+    }
+    return moved;
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (!resolve()) {
+        return ENOMEM;
+    }
+    int rc = g_real.posix_memalign(out, alignment, size);
+    if (rc == 0) {
+        count_alloc(*out);
+    }
+    return rc;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (!resolve()) {
+        return nullptr;
+    }
+    void* ptr = g_real.aligned_alloc(alignment, size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void* memalign(size_t alignment, size_t size) {
+    if (!resolve()) {
+        return nullptr;
+    }
+    void* ptr = g_real.memalign(alignment, size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+void* valloc(size_t size) {
+    if (!resolve()) {
+        return nullptr;
+    }
+    void* ptr = g_real.valloc(size);
+    count_alloc(ptr);
+    return ptr;
+}
+
+// glibc's reallocarray and pvalloc call its internal realloc and memalign
+// directly, never the interposers above, so route them through those.
+void* reallocarray(void* ptr, size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count, size, &bytes)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(ptr, bytes);
+}
+
+void* pvalloc(size_t size) {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (size > SIZE_MAX - page) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    size_t rounded = (size + page - 1) & ~(page - 1);
+    return valloc(rounded == 0 ? page : rounded);
+}
+
+// Bootstrap blocks are unknown to the real allocator.
+size_t malloc_usable_size(void* ptr) {
+    if (ptr == nullptr) {
+        return 0;
+    }
+    if (is_bootstrap(ptr)) {
+        return bootstrap_size(ptr);
+    }
+    if (!resolve()) {
+        return 0;
+    }
+    return g_real.malloc_usable_size(ptr);
+}
+
+}  // extern "C"
+
+// Allocators such as tcmalloc and jemalloc ship their own operator new,
+// which would bypass the malloc interposer; route them through it.
+
+namespace {
+
+void* counted_new(size_t size) {
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* counted_new_aligned(size_t size, std::align_val_t alignment) {
+    void* ptr = nullptr;
+    size_t align = static_cast<size_t>(alignment);
+    if (posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size == 0 ? 1 : size) !=
+        0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return malloc(size == 0 ? 1 : size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return malloc(size == 0 ? 1 : size);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return counted_new_aligned(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return counted_new_aligned(size, alignment);
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
@@ -0,0 +1,235 @@
+#include "harness/heap_profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <utility>
+
+// Allocator entry points, resolved only when the allocator is linked in.
+extern "C" {
+int mallctl(const char* name, void* oldp, size_t* oldlenp, void* newp, size_t newlen)
+    __attribute__((weak));
+void HeapProfilerStart(const char* prefix) __attribute__((weak));
+int IsHeapProfilerRunning() __attribute__((weak));
+char* GetHeapProfile() __attribute__((weak));
+}
+
+namespace mem_harness {
+
+namespace {
+
+HeapProfiler g_profiler = HeapProfiler::kNone;
+
+std::vector<uintptr_t> parse_stack(const std::string& text) {
+    std::vector<uintptr_t> stack;
+    std::istringstream in(text);
+    std::string token;
+    while (in >> token) {
+        stack.push_back(static_cast<uintptr_t>(std::strtoull(token.c_str(), nullptr, 16)));
+    }
+    return stack;
+}
+
+// gperftools: "  objs:  bytes [ allocs: alloc_bytes] @ 0x... 0x..." after a
+// "heap profile:" header line; every allocation is recorded, not sampled.
+bool parse_gperftools(const std::string& profile, HeapSnapshot* snapshot) {
+    std::istringstream in(profile);
+    std::string line;
+    if (!std::getline(in, line) || line.rfind("heap profile:", 0) != 0) {
+        return false;
+    }
+    while (std::getline(in, line) && line.rfind("MAPPED_LIBRARIES:", 0) != 0) {
+        long long objects = 0, bytes = 0;
+        size_t at = line.find('@');
+        if (at == std::string::npos ||
+            std::sscanf(line.c_str(), " %lld: %lld", &objects, &bytes) != 2) {
+            continue;
+        }
+        HeapSnapshot::Site& site = snapshot->sites[parse_stack(line.substr(at + 1))];
+        site.bytes += bytes;
+        site.objects += objects;
+        snapshot->total_bytes += bytes;
+    }
+    return true;
+}
+
+// jemalloc: "heap_v2/<sample period>" header, then "@ 0x... 0x..." stack
+// lines each followed by a "t*: objs: bytes [...]" total. Samples are
+// unbiased the way jeprof does it.
+bool parse_jemalloc(std::istream& in, HeapSnapshot* snapshot) {
+    std::string line;
+    if (!std::getline(in, line) || line.rfind("heap_v2/", 0) != 0) {
+        return false;
+    }
+    const double period = std::strtod(line.c_str() + std::strlen("heap_v2/"), nullptr);
+    std::vector<uintptr_t> stack;
+    bool have_stack = false;
+    while (std::getline(in, line) && line.rfind("MAPPED_LIBRARIES:", 0) != 0) {
+        if (line.rfind("@", 0) == 0) {
+            stack = parse_stack(line.substr(1));
+            have_stack = true;
+            continue;
+        }
+        long long objects = 0, bytes = 0;
+        if (!have_stack || std::sscanf(line.c_str(), " t*: %lld: %lld", &objects, &bytes) != 2) {
+            continue;
+        }
+        have_stack = false;
+        double scale = 1;
+        if (objects > 0 && period > 0) {
+            double mean_size = static_cast<double>(bytes) / objects;
+            scale = 1 / (1 - std::exp(-mean_size / period));
+        }
+        HeapSnapshot::Site& site = snapshot->sites[stack];
+        site.bytes += bytes * scale;
+        site.objects += objects * scale;
+        snapshot->total_bytes += bytes * scale;
+    }
+    return true;
+}
+
+std::string symbolize(uintptr_t address) {
+    std::ostringstream out;
+    Dl_info info;
+    // Return addresses point past the call; look up the call itself.
+    if (dladdr(reinterpret_cast<void*>(address - 1), &info) == 0) {
+        out << "0x" << std::hex << address;
+        return out.str();
+    }
+    if (info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        out << (status == 0 ? demangled : info.dli_sname);
+        std::free(demangled);
+    } else {
+        // No dynamic symbol (e.g. a static function in the executable):
+        // print module+offset for addr2line.
+        const char* module =
+            info.dli_fname != nullptr ? std::strrchr(info.dli_fname, '/') : nullptr;
+        out << (module != nullptr ? module + 1 : "?") << "+0x" << std::hex
+            << address - reinterpret_cast<uintptr_t>(info.dli_fbase);
+    }
+    return out.str();
+}
+
+// Allocator and profiler frames that head every stack.
+bool is_allocator_frame(const std::string& symbol) {
+    static const char* const kPrefixes[] = {
+        "malloc", "calloc", "realloc", "free", "operator new", "operator delete",
+        "je_", "tc_", "posix_memalign", "aligned_alloc", "prof_", "imalloc",
+        "MallocHook", "tcmalloc::",
+    };
+    for (const char* prefix : kPrefixes) {
+        if (symbol.rfind(prefix, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+HeapProfiler start_heap_profiling() {
+    if (mallctl != nullptr) {
+        bool enabled = false;
+        size_t length = sizeof(enabled);
+        if (mallctl("opt.prof", &enabled, &length, nullptr, 0) != 0 || !enabled) {
+            std::cerr << "Warning: jemalloc heap profiling needs a prof-enabled build and "
+                         "MALLOC_CONF=prof:true."
+                      << std::endl;
+            return HeapProfiler::kNone;
+        }
+        bool active = true;
+        mallctl("prof.active", nullptr, nullptr, &active, sizeof(active));
+        g_profiler = HeapProfiler::kJemalloc;
+    } else if (HeapProfilerStart != nullptr && GetHeapProfile != nullptr) {
+        if (IsHeapProfilerRunning == nullptr || !IsHeapProfilerRunning()) {
+            std::string prefix = "/tmp/mem_harness_heap." + std::to_string(getpid());
+            HeapProfilerStart(prefix.c_str());
+        }
+        g_profiler = HeapProfiler::kGperftools;
+    } else {
+        std::cerr << "Warning: no heap profiler linked; use a _jemalloc or _tcmalloc binary."
+                  << std::endl;
+    }
+    return g_profiler;
+}
+
+bool take_heap_snapshot(HeapSnapshot* snapshot) {
+    *snapshot = HeapSnapshot();
+    if (g_profiler == HeapProfiler::kGperftools) {
+        char* profile = GetHeapProfile();
+        if (profile == nullptr) {
+            return false;
+        }
+        bool ok = parse_gperftools(profile, snapshot);
+        std::free(profile);
+        return ok;
+    }
+    if (g_profiler == HeapProfiler::kJemalloc) {
+        static int dumps = 0;
+        std::string path = "/tmp/mem_harness_heap." + std::to_string(getpid()) + "." +
+                           std::to_string(dumps++) + ".heap";
+        const char* name = path.c_str();
+        if (mallctl("prof.dump", nullptr, nullptr, &name, sizeof(name)) != 0) {
+            return false;
+        }
+        std::ifstream in(path);
+        bool ok = parse_jemalloc(in, snapshot);
+        std::remove(path.c_str());
+        return ok;
+    }
+    return false;
+}
+
+std::string format_heap_diff(const HeapSnapshot& first, const HeapSnapshot& last, int top_n,
+                             int frames) {
+    std::vector<std::pair<double, const std::vector<uintptr_t>*>> growth;
+    for (const auto& [stack, site] : last.sites) {
+        auto it = first.sites.find(stack);
+        double delta = site.bytes - (it != first.sites.end() ? it->second.bytes : 0);
+        if (delta > 0) {
+            growth.emplace_back(delta, &stack);
+        }
+    }
+    std::sort(growth.begin(), growth.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "Heap profile: "
+        << first.total_bytes / (1024.0 * 1024.0) << " MB -> "
+        << last.total_bytes / (1024.0 * 1024.0) << " MB live, top retaining stacks:";
+    int shown = 0;
+    for (const auto& [delta, stack] : growth) {
+        if (shown++ == top_n) {
+            break;
+        }
+        out << "\n  " << std::showpos << delta / 1024.0 << std::noshowpos << " KB";
+        int printed = 0;
+        for (uintptr_t address : *stack) {
+            std::string symbol = symbolize(address);
+            if (printed == 0 && is_allocator_frame(symbol)) {
+                continue;
+            }
+            out << (printed == 0 ? "  " : " <- ") << symbol;
+            if (++printed == frames) {
+                break;
+            }
+        }
+    }
+    if (growth.empty()) {
+        out << " none grew";
+    }
+    return out.str();
+}
+
+}  // namespace mem_harness
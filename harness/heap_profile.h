@@ -0,0 +1,59 @@
+#ifndef HARNESS_HEAP_PROFILE_H_
+#define HARNESS_HEAP_PROFILE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief Heap profiler provided by the linked allocator, if any.
+ */
+enum class HeapProfiler {
+    kNone,
+    // jemalloc built with --enable-prof and run with MALLOC_CONF=prof:true.
+    kJemalloc,
+    // gperftools tcmalloc (libtcmalloc), which includes the heap profiler.
+    kGperftools,
+};
+
+/**
+ * @brief In-use heap per allocation stack at one point in time.
+ */
+struct HeapSnapshot {
+    struct Site {
+        // Estimated live bytes and objects; jemalloc samples are unbiased
+        // by the sampling rate.
+        double bytes = 0;
+        double objects = 0;
+    };
+    // Keyed by the allocation stack, innermost frame first.
+    std::map<std::vector<uintptr_t>, Site> sites;
+    double total_bytes = 0;
+};
+
+/**
+ * @brief Starts the allocator's heap profiler. The entry points are weak
+ * symbols, so this is a no-op returning kNone when the glibc or mimalloc
+ * variant is linked.
+ */
+HeapProfiler start_heap_profiling();
+
+/**
+ * @brief Dumps and parses the active profiler's current heap profile.
+ * @return false if no profiler is running or the dump could not be read.
+ */
+bool take_heap_snapshot(HeapSnapshot* snapshot);
+
+/**
+ * @brief Multi-line report of the top_n stacks whose live bytes grew the
+ * most from first to last, each with its first `frames` symbolized frames.
+ */
+std::string format_heap_diff(const HeapSnapshot& first, const HeapSnapshot& last, int top_n,
+                             int frames);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_HEAP_PROFILE_H_
@@ -0,0 +1,134 @@
+#include "harness/helper_thread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <pthread.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "harness/heap_counters.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+
+namespace mem_harness {
+
+namespace {
+
+thread_local HelperStackUsage t_last_usage;
+
+struct HelperArgs {
+    const std::function<void()>* fn;
+    HelperStackUsage* usage;
+    HeapCounters heap;
+    int64_t started_ns;
+    int64_t finished_ns;
+};
+
+void measure_own_stack(HelperStackUsage* usage) {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return;
+    }
+    void* base = nullptr;
+    size_t size = 0;
+    pthread_attr_getstack(&attr, &base, &size);
+    pthread_attr_destroy(&attr);
+
+    const size_t page = sysconf(_SC_PAGE_SIZE);
+    std::vector<unsigned char> resident((size + page - 1) / page);
+    if (mincore(base, size, resident.data()) != 0) {
+        return;
+    }
+    size_t pages = 0;
+    for (unsigned char r : resident) {
+        pages += r & 1;
+    }
+    usage->reserved_bytes = size;
+    usage->resident_bytes = pages * page;
+}
+
+void* helper_main(void* arg) {
+    auto* args = static_cast<HelperArgs*>(arg);
+    args->started_ns = now_ns();
+    (*args->fn)();
+    if (args->usage != nullptr) {
+        measure_own_stack(args->usage);
+    }
+    args->heap = thread_heap_counters();
+    args->finished_ns = now_ns();
+    return nullptr;
+}
+
+std::string format_kb(size_t bytes) {
+    return std::to_string(bytes / 1024) + " KB";
+}
+
+}  // namespace
+
+bool run_helper_thread(size_t stack_size, const std::function<void()>& fn,
+                       HelperStackUsage* usage) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack_size > 0) {
+        stack_size = std::max<size_t>(stack_size, PTHREAD_STACK_MIN);
+        int rc = pthread_attr_setstacksize(&attr, stack_size);
+        if (rc != 0) {
+            std::cerr << "Warning: pthread_attr_setstacksize(" << stack_size
+                      << "): " << std::strerror(rc) << std::endl;
+        }
+    }
+    HelperArgs args{&fn, usage, HeapCounters(), 0, 0};
+    int64_t spawn = now_ns();
+    pthread_t thread;
+    int rc = pthread_create(&thread, &attr, helper_main, &args);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        std::cerr << "Error: pthread_create: " << std::strerror(rc) << std::endl;
+        return false;
+    }
+    pthread_join(thread, nullptr);
+    int64_t joined = now_ns();
+    absorb_heap_counters(args.heap);
+    record_latency("thread_spawn", args.started_ns - spawn);
+    record_latency("thread_join", joined - args.finished_ns);
+    return true;
+}
+
+HelperStackUsage last_helper_stack_usage() {
+    return t_last_usage;
+}
+
+Stage sized_thread_stage(std::function<void(int iteration)> task, size_t stack_size) {
+    return [task = std::move(task), stack_size](int iteration) {
+        std::function<void()> fn = [&task, iteration] { task(iteration); };
+        run_helper_thread(stack_size, fn, &t_last_usage);
+    };
+}
+
+Probe thread_footprint_probe() {
+    return [](int) {
+        std::ostringstream out;
+        out << "VMAs: " << count_vmas();
+        SmapsRollup rollup;
+        if (read_smaps_rollup(&rollup)) {
+            out << std::fixed << std::setprecision(2)
+                << " | Anon: " << rollup.anonymous_kb / 1024.0 << " MB"
+                << " | Private: " << rollup.private_kb / 1024.0 << " MB";
+        }
+        HelperStackUsage usage = last_helper_stack_usage();
+        if (usage.reserved_bytes > 0) {
+            out << " | Helper stack: " << format_kb(usage.resident_bytes) << " / "
+                << format_kb(usage.reserved_bytes);
+        }
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,56 @@
+#ifndef HARNESS_HELPER_THREAD_H_
+#define HARNESS_HELPER_THREAD_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Stack of one helper thread, measured just before it exits.
+ */
+struct HelperStackUsage {
+    // Size of the stack mapping (including the TLS block and thread
+    // descriptor glibc places at its top).
+    size_t reserved_bytes = 0;
+    // Pages of that mapping resident in RAM (mincore), i.e. the deepest the
+    // stack has been, plus TLS. glibc caches and reuses stacks, so this is a
+    // high-water mark across helpers of the same size.
+    size_t resident_bytes = 0;
+};
+
+/**
+ * @brief Runs fn on a new pthread with the given stack size and joins it.
+ * @param stack_size Bytes; zero uses the glibc default (RLIMIT_STACK, normally 8 MB).
+ * @param usage If non-null, receives the helper's stack footprint.
+ * @return false if the thread could not be created; fn did not run.
+ */
+bool run_helper_thread(size_t stack_size, const std::function<void()>& fn,
+                       HelperStackUsage* usage = nullptr);
+
+/**
+ * @brief Stack footprint of the last helper started by spawn_thread_stage()
+ * on the calling thread with a stack size set; zero if none.
+ */
+HelperStackUsage last_helper_stack_usage();
+
+/**
+ * @brief Like spawn_thread_stage(), but the helper is a pthread with an
+ * explicit stack size (zero: glibc default) whose footprint is recorded for
+ * last_helper_stack_usage().
+ */
+Stage sized_thread_stage(std::function<void(int iteration)> task, size_t stack_size);
+
+/**
+ * @brief Probe with the process VMA count, smaps_rollup anonymous and
+ * private memory and the last helper's stack footprint, e.g.
+ * "VMAs: 142 | Anon: 40.10 MB | Private: 41.00 MB | Helper stack: 36 KB / 8192 KB".
+ */
+Probe thread_footprint_probe();
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_HELPER_THREAD_H_
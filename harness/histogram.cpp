@@ -0,0 +1,86 @@
+#include "harness/histogram.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace mem_harness {
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+    constexpr uint64_t kLinear = uint64_t{1} << kSubBucketBits;
+    if (value < kLinear) {
+        return static_cast<int>(value);
+    }
+    // Keep the top kSubBucketBits bits of the value as the sub-bucket.
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (kSubBucketBits - 1);
+    uint64_t mantissa = value >> shift;
+    return (shift << (kSubBucketBits - 1)) + static_cast<int>(mantissa);
+}
+
+int64_t LatencyHistogram::bucket_upper_bound(int index) {
+    constexpr int kHalf = 1 << (kSubBucketBits - 1);
+    if (index < 2 * kHalf) {
+        return index;
+    }
+    int shift = index / kHalf - 1;
+    int64_t mantissa = (index % kHalf) | kHalf;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+    uint64_t value = value_ns < 0 ? 0 : static_cast<uint64_t>(value_ns);
+    ++buckets_[bucket_index(value)];
+    ++count_;
+    sum_ += static_cast<int64_t>(value);
+    max_ = std::max(max_, static_cast<int64_t>(value));
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kNumBuckets; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * count_ + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), count_);
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::string format_duration(double ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    if (ns < 1e6) {
+        out << ns / 1e3 << " us";
+    } else if (ns < 1e9) {
+        out << ns / 1e6 << " ms";
+    } else {
+        out << ns / 1e9 << " s";
+    }
+    return out.str();
+}
+
+std::string format_percentiles(const LatencyHistogram& histogram) {
+    std::ostringstream out;
+    out << "p50: " << format_duration(histogram.percentile(50))
+        << " | p90: " << format_duration(histogram.percentile(90))
+        << " | p99: " << format_duration(histogram.percentile(99))
+        << " | max: " << format_duration(histogram.max());
+    return out.str();
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,58 @@
+#ifndef HARNESS_HISTOGRAM_H_
+#define HARNESS_HISTOGRAM_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace mem_harness {
+
+/**
+ * @brief HDR-style latency histogram with fixed storage.
+ *
+ * Values are bucketed by power-of-two magnitude with 32 linear sub-buckets
+ * per magnitude, so any recorded value is reported within ~3% of its true
+ * value. record() never allocates, which keeps it usable on the hot path.
+ * Not thread-safe: keep one per thread and merge() at the end.
+ */
+class LatencyHistogram {
+ public:
+    void record(int64_t value_ns);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return count_; }
+    int64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0 : static_cast<double>(sum_) / count_; }
+
+    /**
+     * @brief Upper bound of the bucket holding the given percentile (0-100).
+     */
+    int64_t percentile(double p) const;
+
+ private:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kNumBuckets = (64 - kSubBucketBits + 2) << (kSubBucketBits - 1);
+
+    static int bucket_index(uint64_t value);
+    static int64_t bucket_upper_bound(int index);
+
+    std::array<uint64_t, kNumBuckets> buckets_{};
+    uint64_t count_ = 0;
+    int64_t sum_ = 0;
+    int64_t max_ = 0;
+};
+
+/**
+ * @brief "p50: 1.20 ms | p90: ... | p99: ... | max: ..." with units chosen
+ * from the magnitude.
+ */
+std::string format_percentiles(const LatencyHistogram& histogram);
+
+/**
+ * @brief Renders a duration in ns as us, ms or s with two decimals.
+ */
+std::string format_duration(double ns);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_HISTOGRAM_H_
@@ -0,0 +1,48 @@
+// Runs short harness scenarios with --leak_threshold_mb semantics, as a
+// grpc bump in MODULE.bazel would be gated on.
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+namespace {
+
+constexpr size_t kBlock = 2 * 1024 * 1024;
+
+HarnessOptions gate_options() {
+    HarnessOptions options;
+    options.num_iterations = 20;
+    options.leak_warmup_iterations = 5;
+    options.leak_threshold_mb = 0.5;
+    options.quiet = true;
+    return options;
+}
+
+TEST(LeakGateTest, TransientAllocationsPass) {
+    Harness harness(gate_options());
+    harness.add_workload("spike", [](int) {
+        std::unique_ptr<char[]> buffer(new char[kBlock]);
+        std::memset(buffer.get(), 1, kBlock);
+    });
+    harness.run();
+    EXPECT_TRUE(harness.passed());
+}
+
+TEST(LeakGateTest, RetainedAllocationsFail) {
+    std::vector<std::unique_ptr<char[]>> leaked;
+    Harness harness(gate_options());
+    harness.add_workload("leak", [&leaked](int) {
+        leaked.emplace_back(new char[kBlock]);
+        std::memset(leaked.back().get(), 1, kBlock);
+    });
+    harness.run();
+    EXPECT_FALSE(harness.passed());
+}
+
+}  // namespace
+}  // namespace mem_harness
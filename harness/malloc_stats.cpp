@@ -0,0 +1,119 @@
+#include "harness/malloc_stats.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace mem_harness {
+
+#ifdef __GLIBC__
+
+bool capture_malloc_stats(MallocStats* stats) {
+    *stats = MallocStats();
+
+    char* buf = nullptr;
+    size_t len = 0;
+    FILE* stream = open_memstream(&buf, &len);
+    if (stream == nullptr) {
+        return false;
+    }
+    malloc_info(0, stream);
+    std::fclose(stream);
+
+    // The output is one XML element per line. Totals inside <heap> belong to
+    // that arena; the mmap total only appears after the last </heap>.
+    ArenaInfo* arena = nullptr;
+    std::istringstream lines(std::string(buf, len));
+    std::free(buf);
+    std::string line;
+    while (std::getline(lines, line)) {
+        int nr = 0;
+        long count = 0, size = 0;
+        if (std::sscanf(line.c_str(), "<heap nr=\"%d\">", &nr) == 1) {
+            stats->arenas.push_back(ArenaInfo());
+            arena = &stats->arenas.back();
+            arena->nr = nr;
+        } else if (line.rfind("</heap>", 0) == 0) {
+            arena = nullptr;
+        } else if (arena != nullptr &&
+                   (std::sscanf(line.c_str(), "<total type=\"fast\" count=\"%ld\" size=\"%ld\"/>",
+                                &count, &size) == 2 ||
+                    std::sscanf(line.c_str(), "<total type=\"rest\" count=\"%ld\" size=\"%ld\"/>",
+                                &count, &size) == 2)) {
+            arena->free_kb += size / 1024;
+        } else if (arena != nullptr &&
+                   std::sscanf(line.c_str(), "<system type=\"current\" size=\"%ld\"/>",
+                               &size) == 1) {
+            arena->system_kb = size / 1024;
+        } else if (arena == nullptr &&
+                   std::sscanf(line.c_str(), "<total type=\"mmap\" count=\"%ld\" size=\"%ld\"/>",
+                               &count, &size) == 2) {
+            stats->mmap_kb = size / 1024;
+        }
+    }
+
+    for (const ArenaInfo& a : stats->arenas) {
+        stats->free_kb += a.free_kb;
+        stats->in_use_kb += a.system_kb - a.free_kb;
+    }
+#if __GLIBC_PREREQ(2, 33)
+    stats->main_top_kb = mallinfo2().keepcost / 1024;
+#endif
+    return !stats->arenas.empty();
+}
+
+void apply_malloc_tuning(const MallocTuning& tuning) {
+    if (tuning.arena_max >= 0 && mallopt(M_ARENA_MAX, tuning.arena_max) == 0) {
+        std::cerr << "Warning: mallopt(M_ARENA_MAX) failed." << std::endl;
+    }
+    if (tuning.trim_threshold >= 0 && mallopt(M_TRIM_THRESHOLD, tuning.trim_threshold) == 0) {
+        std::cerr << "Warning: mallopt(M_TRIM_THRESHOLD) failed." << std::endl;
+    }
+    if (tuning.mmap_threshold >= 0 && mallopt(M_MMAP_THRESHOLD, tuning.mmap_threshold) == 0) {
+        std::cerr << "Warning: mallopt(M_MMAP_THRESHOLD) failed." << std::endl;
+    }
+}
+
+#else  // !__GLIBC__
+
+bool capture_malloc_stats(MallocStats* stats) {
+    *stats = MallocStats();
+    return false;
+}
+
+void apply_malloc_tuning(const MallocTuning& tuning) {
+    if (tuning.arena_max >= 0 || tuning.trim_threshold >= 0 || tuning.mmap_threshold >= 0) {
+        std::cerr << "Warning: mallopt tuning requires glibc; ignored." << std::endl;
+    }
+}
+
+#endif  // __GLIBC__
+
+std::string format_malloc_stats(const MallocStats& stats) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << "Arenas: " << stats.arenas.size()
+        << " | In use: " << stats.in_use_kb / 1024.0 << " MB"
+        << " | Free: " << stats.free_kb / 1024.0 << " MB"
+        << " | Top: " << stats.main_top_kb / 1024.0 << " MB"
+        << " | Mmap: " << stats.mmap_kb / 1024.0 << " MB";
+    if (!stats.arenas.empty()) {
+        out << " | Per arena (in use/free MB):";
+        const char* separator = " ";
+        for (const ArenaInfo& arena : stats.arenas) {
+            out << separator << "#" << arena.nr << " "
+                << (arena.system_kb - arena.free_kb) / 1024.0 << "/" << arena.free_kb / 1024.0;
+            separator = ", ";
+        }
+    }
+    return out.str();
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,67 @@
+#ifndef HARNESS_MALLOC_STATS_H_
+#define HARNESS_MALLOC_STATS_H_
+
+#include <string>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief One glibc arena as reported by a <heap> section of malloc_info().
+ */
+struct ArenaInfo {
+    int nr = 0;
+    // Memory the arena currently holds from the system.
+    long system_kb = 0;
+    // Free chunks (fastbins, bins and the top chunk) retained by the arena.
+    long free_kb = 0;
+};
+
+/**
+ * @brief glibc allocator state at one point in time.
+ */
+struct MallocStats {
+    std::vector<ArenaInfo> arenas;
+    long in_use_kb = 0;
+    long free_kb = 0;
+    // Live chunks served directly by mmap, outside any arena.
+    long mmap_kb = 0;
+    // Releasable top chunk of the main arena (mallinfo2 keepcost).
+    long main_top_kb = 0;
+};
+
+/**
+ * @brief Captures malloc_info() and mallinfo2() and parses the per-arena sections.
+ *
+ * Only meaningful with glibc malloc; with another allocator linked in, the
+ * glibc arenas are simply unused.
+ * @return false if not built against glibc or the output could not be read.
+ */
+bool capture_malloc_stats(MallocStats* stats);
+
+/**
+ * @brief One-line rendering for the per-iteration output: the totals followed
+ * by in-use/free MB for each arena, e.g.
+ * "Arenas: 2 | In use: 1.20 MB | Free: 30.01 MB | Top: 0.13 MB | Mmap: 0.00 MB
+ * | Per arena (in use/free MB): #0 1.00/0.01, #1 0.20/30.00".
+ */
+std::string format_malloc_stats(const MallocStats& stats);
+
+/**
+ * @brief mallopt() settings; negative values leave the glibc default.
+ */
+struct MallocTuning {
+    long arena_max = -1;       // M_ARENA_MAX
+    long trim_threshold = -1;  // M_TRIM_THRESHOLD, bytes
+    long mmap_threshold = -1;  // M_MMAP_THRESHOLD, bytes
+};
+
+/**
+ * @brief Applies the non-negative fields of tuning with mallopt().
+ * Call before any threads are spawned.
+ */
+void apply_malloc_tuning(const MallocTuning& tuning);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_MALLOC_STATS_H_
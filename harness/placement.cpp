@@ -0,0 +1,205 @@
+#include "harness/placement.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mem_harness {
+
+namespace {
+
+// Node masks cover this many nodes; plenty for any current host.
+constexpr int kMaxNodes = 64;
+
+// "0-3,8,10-11" as in sysfs cpulist/online files.
+std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::istringstream in(text);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        char* end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = *end == '-' ? std::strtol(end + 1, nullptr, 10) : first;
+        for (long v = first; v <= last; ++v) {
+            values.push_back(static_cast<int>(v));
+        }
+    }
+    return values;
+}
+
+std::string read_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// The CPUs the process was allowed at first use, before any pinning.
+const std::vector<int>& initial_cpus() {
+    static const std::vector<int> cpus = [] {
+        std::vector<int> allowed;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    allowed.push_back(cpu);
+                }
+            }
+        }
+        return allowed;
+    }();
+    return cpus;
+}
+
+bool set_affinity(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "Warning: sched_setaffinity: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Online node IDs in ascending order; {0} without NUMA sysfs.
+const std::vector<int>& online_nodes() {
+    static const std::vector<int> nodes = [] {
+        std::vector<int> online = parse_list(read_line("/sys/devices/system/node/online"));
+        return online.empty() ? std::vector<int>{0} : online;
+    }();
+    return nodes;
+}
+
+}  // namespace
+
+int num_numa_nodes() {
+    return static_cast<int>(online_nodes().size());
+}
+
+int numa_node_at(int index) {
+    const std::vector<int>& nodes = online_nodes();
+    return nodes[static_cast<size_t>(index < 0 ? 0 : index) % nodes.size()];
+}
+
+int numa_node_index(int node) {
+    const std::vector<int>& nodes = online_nodes();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i] == node) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int pin_thread_to_cpu(int index) {
+    const std::vector<int>& cpus = initial_cpus();
+    if (cpus.empty() || index < 0) {
+        return -1;
+    }
+    int cpu = cpus[index % cpus.size()];
+    return set_affinity({cpu}) ? cpu : -1;
+}
+
+bool pin_thread_to_node(int node) {
+    if (node < 0 || node >= kMaxNodes) {
+        return false;
+    }
+    std::vector<int> cpus =
+        parse_list(read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+    if (cpus.empty() && node == 0) {
+        // No NUMA sysfs: the whole machine is node 0.
+        cpus = initial_cpus();
+    }
+    if (cpus.empty() || !set_affinity(cpus)) {
+        return false;
+    }
+    unsigned long mask = 1UL << node;
+    // libnuma's numa_set_preferred(), without the dependency.
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, kMaxNodes + 1) != 0) {
+        std::cerr << "Warning: set_mempolicy: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int current_numa_node() {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return -1;
+    }
+    return static_cast<int>(node);
+}
+
+bool bind_pages_to_node(void* addr, size_t length, int node) {
+    if (node < 0 || node >= kMaxNodes) {
+        return false;
+    }
+    const uintptr_t page = sysconf(_SC_PAGE_SIZE);
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) / page * page;
+    uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + length) / page * page;
+    if (end <= begin) {
+        return true;
+    }
+    unsigned long mask = 1UL << node;
+    return syscall(SYS_mbind, begin, end - begin, MPOL_BIND, &mask, kMaxNodes + 1, 0) == 0;
+}
+
+std::vector<long> numa_node_usage_kb() {
+    std::vector<long> usage;
+    std::ifstream in("/proc/self/numa_maps");
+    std::string line;
+    while (std::getline(in, line)) {
+        long page_kb = 4;
+        size_t at = line.find("kernelpagesize_kB=");
+        if (at != std::string::npos) {
+            page_kb =
+                std::strtol(line.c_str() + at + std::strlen("kernelpagesize_kB="), nullptr, 10);
+        }
+        // Per-node page counts: " N<node>=<pages>".
+        for (size_t pos = line.find(" N"); pos != std::string::npos;
+             pos = line.find(" N", pos + 2)) {
+            char* end = nullptr;
+            long node = std::strtol(line.c_str() + pos + 2, &end, 10);
+            if (end == line.c_str() + pos + 2 || *end != '=' || node < 0 || node >= kMaxNodes) {
+                continue;
+            }
+            long pages = std::strtol(end + 1, nullptr, 10);
+            if (static_cast<size_t>(node) >= usage.size()) {
+                usage.resize(node + 1, 0);
+            }
+            usage[node] += pages * page_kb;
+        }
+    }
+    return usage;
+}
+
+Probe numa_probe() {
+    return [](int) {
+        std::vector<long> usage = numa_node_usage_kb();
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << "NUMA:";
+        for (size_t node = 0; node < usage.size(); ++node) {
+            out << (node == 0 ? " N" : " | N") << node << " " << usage[node] / 1024.0 << " MB";
+        }
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
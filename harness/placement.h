@@ -0,0 +1,65 @@
+#ifndef HARNESS_PLACEMENT_H_
+#define HARNESS_PLACEMENT_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Online NUMA nodes (/sys/devices/system/node/online); 1 without NUMA.
+ */
+int num_numa_nodes();
+
+/**
+ * @brief ID of the index-th online NUMA node, modulo the count. Node IDs
+ * need not be contiguous (offline or memoryless nodes leave gaps); 0
+ * without NUMA.
+ */
+int numa_node_at(int index);
+
+/**
+ * @brief Position of node among the online nodes, or -1.
+ */
+int numa_node_index(int node);
+
+/**
+ * @brief Pins the calling thread to the index-th CPU (modulo the count) of
+ * the affinity mask the process started with.
+ * @return The CPU, or -1 on failure.
+ */
+int pin_thread_to_cpu(int index);
+
+/**
+ * @brief Pins the calling thread to node's CPUs and sets its memory policy
+ * to MPOL_PREFERRED for that node.
+ */
+bool pin_thread_to_node(int node);
+
+/**
+ * @brief NUMA node of the CPU the caller is running on, or -1.
+ */
+int current_numa_node();
+
+/**
+ * @brief mbind(MPOL_BIND) for the whole pages in [addr, addr + length).
+ * Must be called before the pages are first touched to take effect.
+ */
+bool bind_pages_to_node(void* addr, size_t length, int node);
+
+/**
+ * @brief Resident memory per node from /proc/self/numa_maps, in KB,
+ * indexed by node.
+ */
+std::vector<long> numa_node_usage_kb();
+
+/**
+ * @brief Probe with the process's memory per node, e.g. "NUMA: N0 40.10 MB | N1 2.00 MB".
+ */
+Probe numa_probe();
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_PLACEMENT_H_
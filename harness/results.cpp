@@ -0,0 +1,122 @@
+#include "harness/results.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+namespace {
+
+ResultFormat g_format = ResultFormat::kText;
+int g_fd = -1;
+// Writes of at most PIPE_BUF bytes to a pipe are atomic; larger ones are not.
+bool g_fd_is_pipe = false;
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool configure_results(ResultFormat format, const std::string& path) {
+    if (format == ResultFormat::kText) {
+        return true;
+    }
+    int fd = STDOUT_FILENO;
+    if (path != "-") {
+        // O_APPEND keeps each write() whole even when forked children share the fd.
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Warning: cannot open results file '" << path
+                      << "': " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    struct stat st;
+    g_fd_is_pipe = ::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+    g_format = format;
+    g_fd = fd;
+    if (format == ResultFormat::kCsv) {
+        static const char kHeader[] = "pid,tid,iteration,phase,rss_kb,elapsed_ns,duration_ns\n";
+        write_all(g_fd, kHeader, sizeof(kHeader) - 1);
+    }
+    return true;
+}
+
+bool results_enabled() {
+    return g_fd >= 0;
+}
+
+bool results_to_stdout() {
+    return g_fd == STDOUT_FILENO;
+}
+
+void write_results(const std::vector<ResultRecord>& records,
+                   const std::vector<std::string>& phase_names, pid_t pid, pid_t tid) {
+    if (g_fd < 0 || records.empty()) {
+        return;
+    }
+    // Writes to a pipe are split at record boundaries into PIPE_BUF-sized
+    // chunks; a record is always shorter than PIPE_BUF.
+    const size_t chunk_limit = g_fd_is_pipe ? PIPE_BUF : std::string::npos;
+    std::vector<std::string> chunks(1);
+    chunks.back().reserve(std::min(records.size() * 128, chunk_limit));
+    char line[256];
+    for (const ResultRecord& r : records) {
+        // Phase names are code-defined identifiers, so they need no escaping.
+        const char* phase = r.phase == kIterationPhase ? "iteration" : phase_names[r.phase].c_str();
+        int n;
+        if (g_format == ResultFormat::kCsv) {
+            n = std::snprintf(line, sizeof(line), "%d,%d,%d,%s,%ld,%lld,%lld\n", pid, tid,
+                              r.iteration, phase, r.rss_kb, static_cast<long long>(r.elapsed_ns),
+                              static_cast<long long>(r.duration_ns));
+        } else {
+            n = std::snprintf(line, sizeof(line),
+                              "{\"pid\":%d,\"tid\":%d,\"iteration\":%d,\"phase\":\"%s\","
+                              "\"rss_kb\":%ld,\"elapsed_ns\":%lld,\"duration_ns\":%lld}\n",
+                              pid, tid, r.iteration, phase, r.rss_kb,
+                              static_cast<long long>(r.elapsed_ns),
+                              static_cast<long long>(r.duration_ns));
+        }
+        if (n <= 0) {
+            continue;
+        }
+        size_t len = std::min<size_t>(n, sizeof(line) - 1);
+        if (chunks.back().size() + len > chunk_limit) {
+            chunks.emplace_back();
+        }
+        chunks.back().append(line, len);
+    }
+    // Keeps threads of this process, and their retries after a short
+    // write, from interleaving, and shares stdout with any text output.
+    std::lock_guard<std::mutex> lock(output_mutex());
+    if (results_to_stdout()) {
+        std::cout.flush();
+    }
+    for (const std::string& chunk : chunks) {
+        write_all(g_fd, chunk.data(), chunk.size());
+    }
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,70 @@
+#ifndef HARNESS_RESULTS_H_
+#define HARNESS_RESULTS_H_
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief Machine-readable result encodings. kText disables recording.
+ */
+enum class ResultFormat {
+    kText,
+    kJsonLines,
+    kCsv,
+};
+
+/**
+ * @brief One measurement: RSS at the end of a phase, or of a whole iteration.
+ */
+struct ResultRecord {
+    int iteration;
+    // Index into the harness's phase names; kIterationPhase for the
+    // end-of-iteration sample.
+    int phase;
+    long rss_kb;
+    // Since the start of Harness::run().
+    int64_t elapsed_ns;
+    // Length of the phase or iteration.
+    int64_t duration_ns;
+};
+
+constexpr int kIterationPhase = -1;
+
+/**
+ * @brief Opens the process-wide result sink; "-" means stdout. For CSV the
+ * header is written here, so forked children that inherit the sink append
+ * rows only. Call once at startup, before forking.
+ * @return false if the file could not be opened; recording stays off.
+ */
+bool configure_results(ResultFormat format, const std::string& path);
+
+/**
+ * @brief True once configure_results() succeeded with a structured format.
+ */
+bool results_enabled();
+
+/**
+ * @brief True when results go to stdout, where text output would corrupt them.
+ */
+bool results_to_stdout();
+
+/**
+ * @brief Encodes records, tagged with pid and tid, and appends them to the
+ * sink.
+ *
+ * Threads of one process are serialized through output_mutex(). Across
+ * forked processes a record is never split: a results file is opened with
+ * O_APPEND and gets one write per call, and a pipe gets writes of at most
+ * PIPE_BUF bytes that end on a record boundary. Other sinks (e.g. a
+ * terminal) carry no such guarantee.
+ */
+void write_results(const std::vector<ResultRecord>& records,
+                   const std::vector<std::string>& phase_names, pid_t pid, pid_t tid);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_RESULTS_H_
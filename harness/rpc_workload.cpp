@@ -0,0 +1,259 @@
+#include "harness/rpc_workload.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <grpcpp/impl/client_unary_call.h>
+#include <grpcpp/impl/rpc_method.h>
+#include <grpcpp/support/sync_stream.h>
+
+#include "harness/echo_server.h"
+#include "harness/sampler.h"
+
+namespace mem_harness {
+
+RpcWorkload::RpcWorkload(RpcOptions options) : options_(options) {
+    options_.outstanding = std::max(1, options_.outstanding);
+    std::string payload(options_.message_size, 'x');
+    grpc::Slice slice(payload);
+    request_ = grpc::ByteBuffer(&slice, 1);
+}
+
+const char* RpcWorkload::api_name(RpcApi api) {
+    switch (api) {
+        case RpcApi::kSync:
+            return "sync";
+        case RpcApi::kAsync:
+            return "async";
+        case RpcApi::kCallback:
+            return "callback";
+    }
+    return "unknown";
+}
+
+int RpcWorkload::sync_calls(grpc::Channel* channel, int count, LatencyHistogram* latency) {
+    static const grpc::internal::RpcMethod method(kEchoUnaryMethod,
+                                                  grpc::internal::RpcMethod::NORMAL_RPC);
+    int ok = 0;
+    for (int i = 0; i < count; ++i) {
+        grpc::ClientContext context;
+        grpc::ByteBuffer response;
+        int64_t start = now_ns();
+        grpc::Status status = grpc::internal::BlockingUnaryCall<grpc::ByteBuffer, grpc::ByteBuffer>(
+            channel, method, &context, request_, &response);
+        if (status.ok()) {
+            latency->record(now_ns() - start);
+            ++ok;
+        }
+    }
+    return ok;
+}
+
+int RpcWorkload::sync_stream(grpc::Channel* channel, int count, LatencyHistogram* latency) {
+    static const grpc::internal::RpcMethod method(kEchoStreamMethod,
+                                                  grpc::internal::RpcMethod::BIDI_STREAMING);
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientReaderWriter<grpc::ByteBuffer, grpc::ByteBuffer>> stream(
+        grpc::internal::ClientReaderWriterFactory<grpc::ByteBuffer, grpc::ByteBuffer>::Create(
+            channel, method, &context));
+    int echoed = 0;
+    grpc::ByteBuffer response;
+    for (int i = 0; i < count; ++i) {
+        int64_t start = now_ns();
+        if (!stream->Write(request_) || !stream->Read(&response)) {
+            break;
+        }
+        latency->record(now_ns() - start);
+        ++echoed;
+    }
+    stream->WritesDone();
+    stream->Finish();
+    return echoed;
+}
+
+int RpcWorkload::run_sync(grpc::Channel* channel, int count) {
+    auto calls = [&](int n, LatencyHistogram* latency) {
+        return options_.streaming ? sync_stream(channel, n, latency)
+                                  : sync_calls(channel, n, latency);
+    };
+    int workers = std::min(options_.outstanding, count);
+    if (workers <= 1) {
+        return calls(count, &latency_);
+    }
+    // One short-lived thread per outstanding RPC, the way a blocking client
+    // gets concurrency.
+    std::vector<LatencyHistogram> latencies(workers);
+    std::vector<int> ok(workers, 0);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (int w = 0; w < workers; ++w) {
+        int share = count / workers + (w < count % workers ? 1 : 0);
+        threads.emplace_back([&, w, share] { ok[w] = calls(share, &latencies[w]); });
+    }
+    int total = 0;
+    for (int w = 0; w < workers; ++w) {
+        threads[w].join();
+        latency_.merge(latencies[w]);
+        total += ok[w];
+    }
+    return total;
+}
+
+int RpcWorkload::run_async(const std::shared_ptr<grpc::Channel>& channel, int count) {
+    struct Call {
+        grpc::ClientContext context;
+        grpc::ByteBuffer response;
+        grpc::Status status;
+        std::unique_ptr<grpc::GenericClientAsyncResponseReader> reader;
+        int64_t start_ns = 0;
+    };
+    grpc::GenericStub stub(channel);
+    grpc::CompletionQueue cq;
+    int issued = 0;
+    auto issue = [&] {
+        auto* call = new Call;
+        call->start_ns = now_ns();
+        call->reader = stub.PrepareUnaryCall(&call->context, kEchoUnaryMethod, request_, &cq);
+        call->reader->StartCall();
+        call->reader->Finish(&call->response, &call->status, call);
+        ++issued;
+    };
+    for (int i = 0; i < std::min(options_.outstanding, count); ++i) {
+        issue();
+    }
+    int ok = 0;
+    void* tag;
+    bool event_ok;
+    for (int done = 0; done < issued && cq.Next(&tag, &event_ok);) {
+        std::unique_ptr<Call> call(static_cast<Call*>(tag));
+        if (event_ok && call->status.ok()) {
+            latency_.record(now_ns() - call->start_ns);
+            ++ok;
+        }
+        ++done;
+        if (issued < count) {
+            issue();
+        }
+    }
+    cq.Shutdown();
+    while (cq.Next(&tag, &event_ok)) {
+    }
+    return ok;
+}
+
+int RpcWorkload::run_callback(const std::shared_ptr<grpc::Channel>& channel, int count) {
+    struct Call {
+        grpc::ClientContext context;
+        grpc::ByteBuffer response;
+        int64_t start_ns = 0;
+    };
+    grpc::GenericStub stub(channel);
+    std::mutex mutex;
+    std::condition_variable finished;
+    int issued = 0;
+    int done = 0;
+    int ok = 0;
+    // Completions run on gRPC's threads and issue the next call from there,
+    // keeping `outstanding` calls in flight without a thread of our own.
+    std::function<void()> issue = [&] {
+        auto* call = new Call;
+        call->start_ns = now_ns();
+        stub.UnaryCall(&call->context, kEchoUnaryMethod, grpc::StubOptions(), &request_,
+                       &call->response, [&, call](grpc::Status status) {
+                           int64_t elapsed = now_ns() - call->start_ns;
+                           delete call;
+                           bool more;
+                           {
+                               std::lock_guard<std::mutex> lock(mutex);
+                               if (status.ok()) {
+                                   latency_.record(elapsed);
+                                   ++ok;
+                               }
+                               ++done;
+                               more = issued < count;
+                               if (more) {
+                                   ++issued;
+                               } else if (done == count) {
+                                   // Under the lock: the waiter owns `finished`.
+                                   finished.notify_all();
+                               }
+                           }
+                           if (more) {
+                               issue();
+                           }
+                       });
+    };
+    int initial = std::min(options_.outstanding, count);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        issued = initial;
+    }
+    for (int i = 0; i < initial; ++i) {
+        issue();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return done == count; });
+    return ok;
+}
+
+void RpcWorkload::run(const std::shared_ptr<grpc::Channel>& channel) {
+    const int count = options_.rpcs_per_iteration;
+    int64_t start = now_ns();
+    int ok = 0;
+    switch (options_.api) {
+        case RpcApi::kSync:
+            ok = run_sync(channel.get(), count);
+            break;
+        case RpcApi::kAsync:
+            ok = run_async(channel, count);
+            break;
+        case RpcApi::kCallback:
+            ok = run_callback(channel, count);
+            break;
+    }
+    completed_ += ok;
+    failed_ += count - ok;
+    busy_ns_ += now_ns() - start;
+}
+
+ResourceUse RpcWorkload::use() {
+    return [self = shared_from_this()](const Resource& resource, int) {
+        self->run(std::static_pointer_cast<grpc::Channel>(resource));
+    };
+}
+
+Probe RpcWorkload::probe() {
+    return [self = shared_from_this()](int) {
+        uint64_t completed = self->completed_ - self->last_completed_;
+        int64_t busy = self->busy_ns_ - self->last_busy_ns_;
+        self->last_completed_ = self->completed_;
+        self->last_busy_ns_ = self->busy_ns_;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(0) << "RPC: "
+            << (busy > 0 ? completed / (busy / 1e9) : 0.0) << " qps";
+        return out.str();
+    };
+}
+
+Report RpcWorkload::report() {
+    return [self = shared_from_this()] {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(0)
+            << "RPC: " << self->completed_ << " ok, " << self->failed_ << " failed, "
+            << (self->busy_ns_ > 0 ? self->completed_ / (self->busy_ns_ / 1e9) : 0.0) << " qps ("
+            << api_name(self->options_.api) << " "
+            << (self->options_.streaming ? "stream" : "unary") << ", "
+            << self->options_.outstanding << " outstanding, " << self->options_.message_size
+            << " B) | " << format_percentiles(self->latency_);
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,103 @@
+#ifndef HARNESS_RPC_WORKLOAD_H_
+#define HARNESS_RPC_WORKLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+
+#include "harness/harness.h"
+#include "harness/histogram.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Client execution model used to issue the RPCs.
+ */
+enum class RpcApi {
+    // Blocking calls; more than one outstanding RPC spawns a std::thread each.
+    kSync,
+    // GenericStub calls driven from a CompletionQueue on the caller's thread.
+    kAsync,
+    // GenericStub callback (reactor) calls completed on gRPC's threads.
+    kCallback,
+};
+
+/**
+ * @brief Shape of the RPC traffic sent each iteration.
+ */
+struct RpcOptions {
+    RpcApi api = RpcApi::kSync;
+    // RPCs in flight at once on the iteration's channel.
+    int outstanding = 1;
+    // Payload bytes per message.
+    size_t message_size = 1024;
+    // Unary calls, or messages on one stream, per iteration.
+    int rpcs_per_iteration = 10;
+    // Echo over bidi streams (one per outstanding RPC) instead of unary
+    // calls. Sync API only.
+    bool streaming = false;
+};
+
+/**
+ * @brief Sends echo traffic over the iteration's channel and keeps latency
+ * and throughput statistics.
+ *
+ * The sync API uses the blocking calls generated sync stubs use; async and
+ * callback go through grpc::GenericStub. Messages are ByteBuffers. run() is
+ * not reentrant: use one instance per harness. Must be owned by a
+ * std::shared_ptr; the hooks below keep it alive.
+ */
+class RpcWorkload : public std::enable_shared_from_this<RpcWorkload> {
+ public:
+    explicit RpcWorkload(RpcOptions options);
+
+    /**
+     * @brief Runs one iteration's traffic over channel.
+     */
+    void run(const std::shared_ptr<grpc::Channel>& channel);
+
+    /**
+     * @brief "sync", "async" or "callback".
+     */
+    static const char* api_name(RpcApi api);
+
+    /**
+     * @brief Churn use-phase that runs the traffic over the churned channel.
+     */
+    ResourceUse use();
+
+    /**
+     * @brief Probe with the last iteration's QPS, e.g. "RPC: 5120 qps".
+     */
+    Probe probe();
+
+    /**
+     * @brief End-of-run report: totals, overall QPS and latency percentiles.
+     */
+    Report report();
+
+ private:
+    // Each returns the number of successful RPCs out of count.
+    int sync_calls(grpc::Channel* channel, int count, LatencyHistogram* latency);
+    int sync_stream(grpc::Channel* channel, int count, LatencyHistogram* latency);
+    int run_sync(grpc::Channel* channel, int count);
+    int run_async(const std::shared_ptr<grpc::Channel>& channel, int count);
+    int run_callback(const std::shared_ptr<grpc::Channel>& channel, int count);
+
+    RpcOptions options_;
+    grpc::ByteBuffer request_;
+    LatencyHistogram latency_;
+    uint64_t completed_ = 0;
+    uint64_t failed_ = 0;
+    int64_t busy_ns_ = 0;
+    uint64_t last_completed_ = 0;
+    int64_t last_busy_ns_ = 0;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_RPC_WORKLOAD_H_
@@ -0,0 +1,173 @@
+#include "harness/rss.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace mem_harness {
+namespace {
+
+// Cached descriptor for /proc/self/statm; -1 until first use.
+std::atomic<int> statm_fd{-1};
+
+void reset_statm_fd_in_child() {
+    int fd = statm_fd.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int get_statm_fd() {
+    int fd = statm_fd.load(std::memory_order_acquire);
+    if (fd >= 0) {
+        return fd;
+    }
+    static const int registered = pthread_atfork(nullptr, nullptr, reset_statm_fd_in_child);
+    (void)registered;
+    int opened = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (opened < 0) {
+        return -1;
+    }
+    int expected = -1;
+    if (!statm_fd.compare_exchange_strong(expected, opened, std::memory_order_acq_rel)) {
+        // Another thread won the race; use its descriptor.
+        close(opened);
+        return expected;
+    }
+    return opened;
+}
+
+long page_size_kb() {
+    static const long kb = sysconf(_SC_PAGE_SIZE) / 1024;
+    return kb;
+}
+
+}  // namespace
+
+bool sample_memory(MemorySample* sample) {
+    *sample = MemorySample();
+    int fd = get_statm_fd();
+    if (fd < 0) {
+        return false;
+    }
+
+    // statm is "size resident shared text lib data dt", all in pages.
+    char buf[128];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+
+    char* cursor = buf;
+    long size = std::strtol(cursor, &cursor, 10);
+    long resident = std::strtol(cursor, &cursor, 10);
+    long shared = std::strtol(cursor, &cursor, 10);
+    (void)size;
+
+    sample->rss_kb = resident * page_size_kb();
+    sample->file_kb = shared * page_size_kb();
+    sample->anon_kb = sample->rss_kb - sample->file_kb;
+    return true;
+}
+
+long get_current_rss_kb() {
+    MemorySample sample;
+    sample_memory(&sample);
+    return sample.rss_kb;
+}
+
+bool read_smaps_rollup(SmapsRollup* rollup) {
+    *rollup = SmapsRollup();
+    int fd = open("/proc/self/smaps_rollup", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+
+    struct Field {
+        const char* key;
+        long* value;
+    };
+    long private_clean = 0, private_dirty = 0;
+    const Field fields[] = {
+        {"Rss:", &rollup->rss_kb},
+        {"Pss:", &rollup->pss_kb},
+        {"Pss_Anon:", &rollup->pss_anon_kb},
+        {"Pss_File:", &rollup->pss_file_kb},
+        {"Anonymous:", &rollup->anonymous_kb},
+        {"AnonHugePages:", &rollup->anon_huge_pages_kb},
+        {"Private_Clean:", &private_clean},
+        {"Private_Dirty:", &private_dirty},
+        {"Swap:", &rollup->swap_kb},
+    };
+    // The first line is the address-range header; the rest are "Key: value kB".
+    for (char* line = std::strchr(buf, '\n'); line != nullptr; line = std::strchr(line, '\n')) {
+        ++line;
+        for (const Field& field : fields) {
+            size_t len = std::strlen(field.key);
+            if (std::strncmp(line, field.key, len) == 0) {
+                *field.value = std::strtol(line + len, nullptr, 10);
+                break;
+            }
+        }
+    }
+    rollup->private_kb = private_clean + private_dirty;
+    return true;
+}
+
+long count_vmas() {
+    int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    long lines = 0;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            lines += buf[i] == '\n';
+        }
+    }
+    close(fd);
+    return n < 0 ? -1 : lines;
+}
+
+FaultCounts get_fault_counts() {
+    FaultCounts counts;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        counts.minor = usage.ru_minflt;
+        counts.major = usage.ru_majflt;
+    }
+    return counts;
+}
+
+long get_peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+long observed_peak_rss_kb(std::initializer_list<long> observed_kb) {
+    long peak = get_peak_rss_kb();
+    for (long kb : observed_kb) {
+        peak = std::max(peak, kb);
+    }
+    return peak;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,97 @@
+#ifndef HARNESS_RSS_H_
+#define HARNESS_RSS_H_
+
+#include <initializer_list>
+
+namespace mem_harness {
+
+/**
+ * @brief One reading of the process memory counters, in KB.
+ */
+struct MemorySample {
+    // Total resident set size.
+    long rss_kb = 0;
+    // Resident anonymous memory (heap, stacks, anonymous mmaps).
+    long anon_kb = 0;
+    // Resident file-backed and shared memory (page cache mappings, shmem).
+    long file_kb = 0;
+};
+
+/**
+ * @brief Reads the process memory counters from /proc/self/statm.
+ *
+ * This implementation is non-portable and targets Linux. The file
+ * descriptor is opened once and re-read with pread() into a stack buffer,
+ * so sampling performs no heap allocation and does not perturb the
+ * allocator being observed. The descriptor is reopened in forked children,
+ * since /proc/self is resolved at open time.
+ * @return false if the counters could not be read; *sample is zeroed.
+ */
+bool sample_memory(MemorySample* sample);
+
+/**
+ * @brief Process-wide totals from /proc/self/smaps_rollup, in KB.
+ */
+struct SmapsRollup {
+    long rss_kb = 0;
+    // Proportional set size: shared pages divided among their mappers.
+    long pss_kb = 0;
+    long pss_anon_kb = 0;
+    long pss_file_kb = 0;
+    long anonymous_kb = 0;
+    long anon_huge_pages_kb = 0;
+    long private_kb = 0;  // Private_Clean + Private_Dirty
+    long swap_kb = 0;
+};
+
+/**
+ * @brief Reads /proc/self/smaps_rollup (Linux 4.14+) into a stack buffer.
+ * Costlier than statm: the kernel walks every mapping.
+ * @return false if the file could not be read; *rollup is zeroed.
+ */
+bool read_smaps_rollup(SmapsRollup* rollup);
+
+/**
+ * @brief Number of mappings (VMAs) in /proc/self/maps, or -1 on error.
+ */
+long count_vmas();
+
+/**
+ * @brief Current process Resident Set Size in KB, or 0 if unable to read.
+ */
+long get_current_rss_kb();
+
+/**
+ * @brief Page faults taken by the whole process since it started.
+ */
+struct FaultCounts {
+    // Served without I/O (e.g. zero-fill of anonymous memory, page cache hits).
+    long minor = 0;
+    // Required reading from disk.
+    long major = 0;
+};
+
+/**
+ * @brief Process fault counters (getrusage; same values as minflt/majflt
+ * in /proc/self/stat).
+ */
+FaultCounts get_fault_counts();
+
+/**
+ * @brief Process high-water RSS in KB (getrusage ru_maxrss).
+ */
+long get_peak_rss_kb();
+
+/**
+ * @brief Peak RSS to report next to statm readings: the larger of
+ * get_peak_rss_kb() and every value in observed_kb.
+ *
+ * ru_maxrss is updated lazily and can trail the statm RSS, so a raw
+ * get_peak_rss_kb() may print below the final RSS it is shown beside.
+ * Every peak column goes through this helper.
+ */
+long observed_peak_rss_kb(std::initializer_list<long> observed_kb);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_RSS_H_
@@ -0,0 +1,66 @@
+// Peak RSS must never print below the RSS it is reported beside, as in the
+// sweep and channel matrix tables.
+
+#include "harness/rss.h"
+
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "harness/child.h"
+
+namespace mem_harness {
+namespace {
+
+// Above glibc's mmap threshold, so free() hands the pages back at once.
+constexpr size_t kBlock = 64 * 1024 * 1024;
+
+// Escapes the transient block so the optimizer keeps its allocation.
+char* volatile g_escape = nullptr;
+
+struct PeakResult {
+    long high_rss_kb = 0;
+    long final_rss_kb = 0;
+    long peak_rss_kb = 0;
+};
+
+TEST(ObservedPeakRssTest, NotBelowAnyReading) {
+    long current = get_current_rss_kb();
+    ASSERT_GT(current, 0);
+    EXPECT_GE(observed_peak_rss_kb({current}), current);
+    EXPECT_GE(observed_peak_rss_kb({current + (1L << 30)}), current + (1L << 30));
+    EXPECT_GE(observed_peak_rss_kb({}), get_peak_rss_kb());
+}
+
+// Same shape as a matrix profile: the forked child only passes its initial
+// and final readings, so the transient block between them must come from
+// the process high-water mark.
+TEST(ObservedPeakRssTest, PeakCoversTransientBlockInChild) {
+    PeakResult result;
+    ASSERT_TRUE(run_in_child(
+        [] {
+            PeakResult r;
+            long initial = get_current_rss_kb();
+            {
+                std::unique_ptr<char[]> transient(new char[kBlock]);
+                std::memset(transient.get(), 1, kBlock);
+                g_escape = transient.get();
+                r.high_rss_kb = get_current_rss_kb();
+            }
+            r.final_rss_kb = get_current_rss_kb();
+            r.peak_rss_kb = observed_peak_rss_kb({initial, r.final_rss_kb});
+            return r;
+        },
+        &result));
+    ASSERT_GT(result.final_rss_kb, 0);
+    // The block was returned, so the peak stands well above the final RSS.
+    EXPECT_LT(result.final_rss_kb, result.high_rss_kb - static_cast<long>(kBlock / 1024 / 2));
+    // ru_maxrss is folded from lazily synced RSS counters and may trail the
+    // statm high-water reading by a few hundred KB.
+    EXPECT_GE(result.peak_rss_kb, result.high_rss_kb - 1024);
+    EXPECT_GE(result.peak_rss_kb, result.final_rss_kb + static_cast<long>(kBlock / 1024 / 2));
+}
+
+}  // namespace
+}  // namespace mem_harness
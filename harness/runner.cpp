@@ -0,0 +1,99 @@
+#include "harness/runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace mem_harness {
+
+void parse_summary(const std::string& line, BinaryRun* run) {
+    const char* summary = std::strstr(line.c_str(), "Summary:");
+    if (summary == nullptr) {
+        return;
+    }
+    long steady = 0, final_rss = 0, peak = 0;
+    if (std::sscanf(summary, "Summary: steady_rss_kb=%ld final_rss_kb=%ld peak_rss_kb=%ld",
+                    &steady, &final_rss, &peak) != 3) {
+        return;
+    }
+    ++run->summaries;
+    run->steady_rss_kb += steady;
+    run->final_rss_kb = std::max(run->final_rss_kb, final_rss);
+    run->peak_rss_kb = std::max(run->peak_rss_kb, peak);
+    // Older and non-harness binaries may omit the latency fields.
+    double ms = 0;
+    if (const char* mean = std::strstr(summary, "mean_iteration_ms=")) {
+        std::sscanf(mean, "mean_iteration_ms=%lf", &ms);
+        run->mean_iteration_ms += ms;
+    }
+    if (const char* max = std::strstr(summary, "max_iteration_ms=")) {
+        std::sscanf(max, "max_iteration_ms=%lf", &ms);
+        run->max_iteration_ms = std::max(run->max_iteration_ms, ms);
+    }
+}
+
+BinaryRun run_binary(const std::string& binary, const std::vector<std::string>& args,
+                     const std::string& echo_prefix) {
+    BinaryRun run;
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        perror("pipe");
+        return run;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(binary.c_str()));
+        for (const std::string& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execv(binary.c_str(), argv.data());
+        perror(binary.c_str());
+        _exit(127);
+    } else if (pid < 0) {
+        perror("fork");
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return run;
+    }
+    close(pipe_fds[1]);
+
+    FILE* out = fdopen(pipe_fds[0], "r");
+    char buf[4096];
+    while (std::fgets(buf, sizeof(buf), out) != nullptr) {
+        std::string line(buf);
+        if (!echo_prefix.empty()) {
+            std::cout << echo_prefix << line;
+        }
+        parse_summary(line, &run);
+    }
+    std::fclose(out);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    run.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // For a reaped child ru_maxrss also covers the grandchildren it reaped.
+    run.peak_rss_kb = std::max(run.peak_rss_kb, usage.ru_maxrss);
+    run.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && run.summaries > 0;
+    if (run.summaries > 0) {
+        run.steady_rss_kb /= run.summaries;
+        run.mean_iteration_ms /= run.summaries;
+    }
+    return run;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,41 @@
+#ifndef HARNESS_RUNNER_H_
+#define HARNESS_RUNNER_H_
+
+#include <string>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief Outcome of running one harness binary, folded from the "Summary:"
+ * lines it printed (one per Harness::run(), so several for the concurrent
+ * binary).
+ */
+struct BinaryRun {
+    bool ok = false;
+    int summaries = 0;
+    double steady_rss_kb = 0;      // mean over all "Summary:" lines
+    long final_rss_kb = 0;         // max over all "Summary:" lines
+    double mean_iteration_ms = 0;  // mean over all "Summary:" lines
+    double max_iteration_ms = 0;   // max over all "Summary:" lines
+    long peak_rss_kb = 0;          // max of ru_maxrss (run and children) and Summary peaks
+    double wall_s = 0;
+};
+
+/**
+ * @brief Folds one output line into *run if it is a "Summary:" line.
+ */
+void parse_summary(const std::string& line, BinaryRun* run);
+
+/**
+ * @brief Runs binary with args to completion, capturing its stdout. ok is
+ * set when it exits with status 0 and printed at least one summary.
+ * @param echo_prefix When non-empty, every output line is echoed to
+ * std::cout behind this prefix.
+ */
+BinaryRun run_binary(const std::string& binary, const std::vector<std::string>& args,
+                     const std::string& echo_prefix = "");
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_RUNNER_H_
@@ -0,0 +1,161 @@
+#include "harness/sampler.h"
+
+#include <algorithm>
+
+namespace mem_harness {
+namespace {
+
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+}  // namespace
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+SampleRing::SampleRing(size_t capacity)
+    : slots_(new TimedSample[round_up_pow2(std::max<size_t>(capacity, 2))]),
+      mask_(round_up_pow2(std::max<size_t>(capacity, 2)) - 1) {}
+
+bool SampleRing::push(const TimedSample& sample) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) > mask_) {
+        return false;
+    }
+    slots_[head & mask_] = sample;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool SampleRing::pop(TimedSample* sample) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *sample = slots_[tail & mask_];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+BackgroundSampler::BackgroundSampler(std::chrono::microseconds interval, size_t capacity)
+    : interval_(interval), ring_(capacity) {}
+
+BackgroundSampler::~BackgroundSampler() { stop(); }
+
+void BackgroundSampler::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&BackgroundSampler::run, this);
+}
+
+void BackgroundSampler::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    thread_.join();
+}
+
+void BackgroundSampler::drain(const std::function<void(const TimedSample&)>& consume) {
+    TimedSample sample;
+    while (ring_.pop(&sample)) {
+        consume(sample);
+    }
+}
+
+void BackgroundSampler::run() {
+    auto next = std::chrono::steady_clock::now();
+    while (running_.load(std::memory_order_relaxed)) {
+        TimedSample sample;
+        sample.t_ns = now_ns();
+        sample_memory(&sample.memory);
+        if (!ring_.push(sample)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        next += interval_;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+std::vector<PhaseSummary> summarize_phases(const std::vector<TimedSample>& samples,
+                                           const std::vector<PhaseSpan>& spans,
+                                           const std::vector<std::string>& phase_names,
+                                           long release_tolerance_kb, int64_t max_gap_ns,
+                                           bool truncated) {
+    std::vector<PhaseSummary> summaries(phase_names.size());
+    std::vector<int> released(phase_names.size(), 0);
+    for (size_t i = 0; i < phase_names.size(); ++i) {
+        summaries[i].name = phase_names[i];
+    }
+
+    auto by_time = [](const TimedSample& s, int64_t t) { return s.t_ns < t; };
+    for (const PhaseSpan& span : spans) {
+        PhaseSummary& summary = summaries[span.phase];
+        ++summary.occurrences;
+
+        auto first = std::lower_bound(samples.begin(), samples.end(), span.start_ns, by_time);
+        auto after = std::lower_bound(first, samples.end(), span.end_ns, by_time);
+        // Baseline is the last sample taken before the phase started; it
+        // and the samples up to the first one after the phase must follow
+        // each other closely, or the span is not covered.
+        if (first == samples.begin() || after == samples.end() ||
+            span.start_ns - (first - 1)->t_ns > max_gap_ns) {
+            ++summary.skipped;
+            continue;
+        }
+        auto baseline_it = first - 1;
+        long baseline = baseline_it->memory.rss_kb;
+        long peak = baseline;
+        bool covered = true;
+        for (auto it = first; it != after + 1; ++it) {
+            covered = covered && it->t_ns - (it - 1)->t_ns <= max_gap_ns;
+            if (it != after) {
+                peak = std::max(peak, it->memory.rss_kb);
+            }
+        }
+        if (!covered) {
+            ++summary.skipped;
+            continue;
+        }
+        summary.peak_rss_kb = std::max(summary.peak_rss_kb, peak);
+        summary.max_rise_kb = std::max(summary.max_rise_kb, peak - baseline);
+
+        // Look for the release only while the samples stay continuous.
+        auto release = after;
+        while (release != samples.end() &&
+               release->memory.rss_kb > baseline + release_tolerance_kb &&
+               release + 1 != samples.end() && (release + 1)->t_ns - release->t_ns <= max_gap_ns) {
+            ++release;
+        }
+        if (release->memory.rss_kb > baseline + release_tolerance_kb) {
+            // Coverage ended first: a gap, or samples cut off by the cap.
+            if (release + 1 != samples.end() || truncated) {
+                ++summary.skipped;
+            } else {
+                ++summary.unreleased;
+            }
+            continue;
+        }
+        double release_ms = (release->t_ns - span.end_ns) / 1e6;
+        summary.mean_release_ms += release_ms;
+        summary.max_release_ms = std::max(summary.max_release_ms, release_ms);
+        ++released[span.phase];
+    }
+
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        if (released[i] > 0) {
+            summaries[i].mean_release_ms /= released[i];
+        }
+    }
+    return summaries;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,138 @@
+#ifndef HARNESS_SAMPLER_H_
+#define HARNESS_SAMPLER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "harness/rss.h"
+
+namespace mem_harness {
+
+/**
+ * @brief A memory sample stamped with steady_clock time in nanoseconds.
+ */
+struct TimedSample {
+    int64_t t_ns = 0;
+    MemorySample memory;
+};
+
+/**
+ * @brief Fixed-capacity single-producer / single-consumer lock-free ring.
+ *
+ * The storage is allocated once up front; push() and pop() never allocate.
+ * When the ring is full push() drops the sample and returns false.
+ */
+class SampleRing {
+ public:
+    // capacity is rounded up to a power of two.
+    explicit SampleRing(size_t capacity);
+
+    bool push(const TimedSample& sample);
+    bool pop(TimedSample* sample);
+
+ private:
+    std::unique_ptr<TimedSample[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};  // next slot to write
+    alignas(64) std::atomic<size_t> tail_{0};  // next slot to read
+};
+
+/**
+ * @brief Wall-clock span of one phase in one iteration, as marked by the loop.
+ */
+struct PhaseSpan {
+    int phase = 0;
+    int iteration = 0;
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+};
+
+/**
+ * @brief Background thread that samples memory at a fixed interval.
+ *
+ * The sampler thread is the only producer for its ring; the owning thread
+ * drains it with drain() and is the only consumer.
+ */
+class BackgroundSampler {
+ public:
+    BackgroundSampler(std::chrono::microseconds interval, size_t capacity);
+    ~BackgroundSampler();
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Pops every buffered sample and passes it to consume, in time
+     * order. Allocates nothing; the caller decides what to keep.
+     */
+    void drain(const std::function<void(const TimedSample&)>& consume);
+
+    /**
+     * @brief Number of samples lost because the ring was full.
+     */
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+    void run();
+
+    std::chrono::microseconds interval_;
+    SampleRing ring_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::thread thread_;
+};
+
+/**
+ * @brief Per-phase peak and time-to-release derived from samples and spans.
+ */
+struct PhaseSummary {
+    std::string name;
+    int occurrences = 0;
+    // Highest RSS seen while the phase was running.
+    long peak_rss_kb = 0;
+    // Largest rise above the RSS sampled just before the phase started.
+    long max_rise_kb = 0;
+    // Time from phase end until RSS fell back within tolerance of the
+    // pre-phase level, over occurrences that did release.
+    double mean_release_ms = 0;
+    double max_release_ms = 0;
+    // Occurrences whose memory never came back within tolerance.
+    int unreleased = 0;
+    // Occurrences without continuous samples from just before the phase
+    // to its release (samples dropped by soak filtering or past the kept
+    // cap); left out of every field above but occurrences.
+    int skipped = 0;
+};
+
+/**
+ * @brief Correlates samples with phase spans.
+ * @param samples Samples in time order.
+ * @param spans Phase spans in time order.
+ * @param phase_names Indexed by PhaseSpan::phase.
+ * @param release_tolerance_kb Slack above the pre-phase RSS that still counts as released.
+ * @param max_gap_ns Widest spacing of consecutive samples that still counts
+ * as continuous, e.g. a few sampling intervals.
+ * @param truncated The samples stop before the run did, so running out of
+ * them does not make a phase unreleased.
+ */
+std::vector<PhaseSummary> summarize_phases(const std::vector<TimedSample>& samples,
+                                           const std::vector<PhaseSpan>& spans,
+                                           const std::vector<std::string>& phase_names,
+                                           long release_tolerance_kb, int64_t max_gap_ns,
+                                           bool truncated);
+
+/**
+ * @brief steady_clock::now() in nanoseconds.
+ */
+int64_t now_ns();
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_SAMPLER_H_
@@ -0,0 +1,91 @@
+#include "harness/sweep.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "harness/child.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+
+namespace mem_harness {
+namespace {
+
+// Fixed-size record a sweep child sends back through run_in_child().
+struct PointResult {
+    long initial_rss_kb = 0;
+    long final_rss_kb = 0;
+    long peak_rss_kb = 0;
+    double elapsed_ms = 0;
+    bool passed = true;
+};
+
+PointResult run_point_in_child(size_t buffer_size, int threads, const SweepScenario& scenario,
+                               const std::function<void()>& warmup) {
+    if (warmup) {
+        warmup();
+    }
+    PointResult result;
+    int64_t start = now_ns();
+    result.initial_rss_kb = get_current_rss_kb();
+
+    std::atomic<bool> passed{true};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&scenario, &passed, buffer_size, t] {
+            if (!scenario(buffer_size, t)) {
+                passed = false;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    result.final_rss_kb = get_current_rss_kb();
+    result.peak_rss_kb = observed_peak_rss_kb({result.initial_rss_kb, result.final_rss_kb});
+    result.elapsed_ms = (now_ns() - start) / 1e6;
+    result.passed = passed;
+    return result;
+}
+
+}  // namespace
+
+bool run_sweep(const SweepOptions& options, const SweepScenario& scenario,
+               const std::function<void()>& warmup) {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Sweep: buffer sizes " << options.min_size / 1024 << " KB.."
+              << options.max_size / 1024 << " KB, threads 1.." << options.max_threads << std::endl;
+    std::cout << std::setw(14) << "Buffer (KB)" << std::setw(9) << "Threads"
+              << std::setw(18) << "Retained (MB)" << std::setw(16) << "Final (MB)"
+              << std::setw(15) << "Peak (MB)" << std::setw(14) << "Time (ms)"
+              << "  Returned" << std::endl;
+
+    bool all_ok = true;
+    for (size_t size = options.min_size; size <= options.max_size && size > 0; size *= 2) {
+        for (int threads = 1; threads <= options.max_threads; ++threads) {
+            PointResult result;
+            bool ok = run_in_child(
+                [&] { return run_point_in_child(size, threads, scenario, warmup); }, &result) &&
+                      result.passed;
+            all_ok = all_ok && ok;
+            long retained = result.final_rss_kb - result.initial_rss_kb;
+            std::cout << std::setw(14) << size / 1024 << std::setw(9) << threads;
+            if (!ok) {
+                std::cout << "  FAILED" << std::endl;
+                continue;
+            }
+            std::cout << std::setw(18) << retained / 1024.0
+                      << std::setw(16) << result.final_rss_kb / 1024.0
+                      << std::setw(15) << result.peak_rss_kb / 1024.0
+                      << std::setw(14) << result.elapsed_ms
+                      << "  " << (retained <= options.release_tolerance_kb ? "yes" : "no")
+                      << std::endl;
+        }
+    }
+    return all_ok;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,46 @@
+#ifndef HARNESS_SWEEP_H_
+#define HARNESS_SWEEP_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace mem_harness {
+
+/**
+ * @brief Grid of buffer sizes and thread counts to sweep in one run.
+ */
+struct SweepOptions {
+    // Buffer sizes double from min_size up to and including max_size.
+    size_t min_size = 64 * 1024;
+    size_t max_size = 256 * 1024 * 1024;
+    // Thread counts 1..max_threads.
+    int max_threads = 1;
+    // Retained RSS at or below this counts as returned to the OS.
+    long release_tolerance_kb = 1024;
+};
+
+/**
+ * @brief Runs one thread's share of a sweep point. Should run a quiet
+ * Harness with the given buffer size.
+ * @return false if this thread's run failed.
+ */
+using SweepScenario = std::function<bool(size_t buffer_size, int thread_index)>;
+
+/**
+ * @brief Runs scenario on 1..max_threads threads for every buffer size and
+ * prints a table of retained, final and peak RSS per point.
+ *
+ * Each point runs in its own forked child so that arenas and caches grown
+ * by one point do not leak into the next. A child's retained RSS is its
+ * RSS after all threads joined minus its RSS before they started.
+ * @param warmup Run in each child before the baseline is taken, e.g. to
+ * pay for one-time gRPC initialization; may be empty.
+ * @return false if any point failed, i.e. its child did not report back or
+ * one of its scenario calls returned false.
+ */
+bool run_sweep(const SweepOptions& options, const SweepScenario& scenario,
+               const std::function<void()>& warmup = nullptr);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_SWEEP_H_
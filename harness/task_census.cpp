@@ -0,0 +1,165 @@
+#include "harness/task_census.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace mem_harness {
+namespace {
+
+// Reads a comm file, dropping the trailing newline; empty on error.
+std::string read_comm(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return "";
+    }
+    char buf[64];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    close(fd);
+    if (n <= 0) {
+        return "";
+    }
+    if (buf[n - 1] == '\n') {
+        --n;
+    }
+    return std::string(buf, n);
+}
+
+// Calls fn for every numeric entry of dir_path; returns false if unreadable.
+template <typename Fn>
+bool for_each_entry(const char* dir_path, Fn fn) {
+    DIR* dir = opendir(dir_path);
+    if (dir == nullptr) {
+        return false;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            fn(entry->d_name, dirfd(dir));
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+std::string format_delta(int delta) {
+    return (delta >= 0 ? "+" : "") + std::to_string(delta);
+}
+
+// "+event_engine x2, -timer_manager" for the names whose count changed.
+std::string format_name_changes(const std::map<std::string, int>& before,
+                                const std::map<std::string, int>& after) {
+    std::map<std::string, int> changes;
+    for (const auto& [name, count] : after) {
+        changes[name] += count;
+    }
+    for (const auto& [name, count] : before) {
+        changes[name] -= count;
+    }
+    std::ostringstream out;
+    for (const auto& [name, delta] : changes) {
+        if (delta == 0) {
+            continue;
+        }
+        out << (out.tellp() > 0 ? ", " : "") << (delta > 0 ? "+" : "-") << name;
+        if (std::abs(delta) > 1) {
+            out << " x" << std::abs(delta);
+        }
+    }
+    return out.str();
+}
+
+}  // namespace
+
+bool take_task_census(TaskCensus* census) {
+    *census = TaskCensus();
+    census->names = thread_names();
+    for (const auto& [name, count] : census->names) {
+        census->threads += count;
+    }
+    return for_each_entry("/proc/self/fd", [census](const char* fd, int own_fd) {
+        if (std::atoi(fd) != own_fd) {
+            ++census->fds;
+        }
+    }) && census->threads > 0;
+}
+
+std::map<std::string, int> thread_names() {
+    std::map<std::string, int> names;
+    for_each_entry("/proc/self/task", [&names](const char* tid, int) {
+        ++names[read_comm(std::string("/proc/self/task/") + tid + "/comm")];
+    });
+    return names;
+}
+
+std::string main_thread_name() { return read_comm("/proc/self/comm"); }
+
+TaskTracker::TaskTracker(int warmup_iterations) : warmup_iterations_(warmup_iterations) {}
+
+Probe TaskTracker::probe() {
+    return [self = shared_from_this()](int iteration) {
+        TaskCensus census;
+        take_task_census(&census);
+        std::ostringstream out;
+        out << "Threads: " << census.threads;
+        if (!self->threads_.empty()) {
+            out << " (" << format_delta(census.threads - self->threads_.back());
+            std::string changes = format_name_changes(self->last_names_, census.names);
+            if (!changes.empty()) {
+                out << ": " << changes;
+            }
+            out << ")";
+        }
+        out << " | FDs: " << census.fds;
+        if (!self->fds_.empty()) {
+            out << " (" << format_delta(census.fds - self->fds_.back()) << ")";
+        }
+        self->iterations_.push_back(iteration);
+        self->threads_.push_back(census.threads);
+        self->fds_.push_back(census.fds);
+        self->last_names_ = std::move(census.names);
+        return out.str();
+    };
+}
+
+Report TaskTracker::report() {
+    return [self = shared_from_this()] {
+        const size_t n = self->threads_.size();
+        if (n == 0) {
+            return std::string();
+        }
+        // Growth is measured from the first sample at or after the last
+        // warm-up iteration to the end.
+        const int warmup = self->warmup_iterations_ < 0 ? (self->iterations_.back() + 1) / 2
+                                                        : self->warmup_iterations_;
+        size_t base = 0;
+        while (base + 1 < n && self->iterations_[base] < warmup - 1) {
+            ++base;
+        }
+        int thread_growth = self->threads_.back() - self->threads_[base];
+        int fd_growth = self->fds_.back() - self->fds_[base];
+
+        std::ostringstream out;
+        out << "Tasks: threads " << self->threads_.front() << " -> " << self->threads_.back()
+            << " (peak " << *std::max_element(self->threads_.begin(), self->threads_.end())
+            << "), fds " << self->fds_.front() << " -> " << self->fds_.back() << " (peak "
+            << *std::max_element(self->fds_.begin(), self->fds_.end()) << ") | since iteration "
+            << self->iterations_[base] + 1 << ": threads " << format_delta(thread_growth)
+            << ", fds " << format_delta(fd_growth) << " "
+            << (thread_growth > 0 || fd_growth > 0 ? "GROWING" : "steady") << " | names: ";
+        const char* separator = "";
+        for (const auto& [name, count] : self->last_names_) {
+            out << separator << name;
+            separator = ", ";
+            if (count > 1) {
+                out << " x" << count;
+            }
+        }
+        return out.str();
+    };
+}
+
+}  // namespace mem_harness
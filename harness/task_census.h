@@ -0,0 +1,83 @@
+#ifndef HARNESS_TASK_CENSUS_H_
+#define HARNESS_TASK_CENSUS_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Process-wide thread and file descriptor counts at one point in time.
+ */
+struct TaskCensus {
+    // Entries in /proc/self/task.
+    int threads = 0;
+    // Entries in /proc/self/fd, excluding the one used to list it.
+    int fds = 0;
+    // Threads per name (/proc/self/task/<tid>/comm, at most 15 characters).
+    std::map<std::string, int> names;
+};
+
+/**
+ * @brief Lists /proc/self/task and /proc/self/fd into *census.
+ * @return false if either could not be read; *census is then partial.
+ */
+bool take_task_census(TaskCensus* census);
+
+/**
+ * @brief Threads per name; empty on error.
+ */
+std::map<std::string, int> thread_names();
+
+/**
+ * @brief Name of the main thread (/proc/self/comm), which threads started
+ * by the harness inherit; empty on error.
+ */
+std::string main_thread_name();
+
+/**
+ * @brief Tracks thread and fd counts across a run, as a second leak signal
+ * next to RSS: gRPC's executors, EventEngine pools and sockets show up here
+ * before their arenas show up in RSS.
+ *
+ * Counts are process-wide, so concurrent harnesses in one process see each
+ * other's threads. Must be owned by a std::shared_ptr; the hooks keep it alive.
+ */
+class TaskTracker : public std::enable_shared_from_this<TaskTracker> {
+ public:
+    /**
+     * @param warmup_iterations Iterations excluded from the growth check;
+     * negative means the first half, as in the leak check.
+     */
+    explicit TaskTracker(int warmup_iterations);
+
+    /**
+     * @brief Probe with the counts and their change since the previous
+     * iteration, naming threads that came or went, e.g.
+     * "Threads: 12 (+2: +event_engine x2) | FDs: 9 (+0)".
+     */
+    Probe probe();
+
+    /**
+     * @brief End-of-run report: first, last and peak counts, growth past the
+     * warm-up with a "steady" or "GROWING" verdict, and the final thread names.
+     */
+    Report report();
+
+ private:
+    int warmup_iterations_;
+    // One entry per probe call, which with a report interval is not one
+    // per iteration; iterations_ holds the iteration each was taken after.
+    std::vector<int> iterations_;
+    std::vector<int> threads_;
+    std::vector<int> fds_;
+    std::map<std::string, int> last_names_;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_TASK_CENSUS_H_
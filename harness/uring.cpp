@@ -0,0 +1,201 @@
+#include "harness/uring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sched.h>
+
+namespace mem_harness {
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+unsigned load_acquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+void store_release(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+template <typename T>
+T* at(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+Uring::~Uring() {
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+}
+
+bool Uring::init(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = io_uring_setup(entries, &params);
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    entries_ = params.sq_entries;
+    remainders_.reserve(entries_);
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && cq_ring_size_ > sq_ring_size_) {
+        sq_ring_size_ = cq_ring_size_;
+    }
+
+    void* sq = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return false;
+    }
+    sq_ring_ = sq;
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        void* cq = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return false;
+        }
+        cq_ring_ = cq;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = sqes;
+
+    sq_tail_ = at<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = at<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_ = at<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = at<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = at<void>(cq_ring_, params.cq_off.cqes);
+    return true;
+}
+
+unsigned Uring::submit_and_wait(unsigned to_submit) {
+    unsigned submitted = 0;
+    while (submitted < to_submit) {
+        unsigned left = to_submit - submitted;
+        int ret = io_uring_enter(ring_fd_, left, left, IORING_ENTER_GETEVENTS);
+        if (ret < 0 && errno == EINTR) {
+            // Interrupted before anything was submitted; try again.
+            continue;
+        }
+        if (ret <= 0) {
+            if (last_error_ == 0) {
+                last_error_ = ret < 0 ? -errno : -EAGAIN;
+            }
+            break;
+        }
+        // With IORING_ENTER_GETEVENTS the call has also waited for its
+        // completions once everything is submitted.
+        submitted += static_cast<unsigned>(ret);
+    }
+    return submitted;
+}
+
+void Uring::wait_for_completion() {
+    if (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        // Submitted writes still complete; poll for them instead.
+        sched_yield();
+    }
+}
+
+bool Uring::write_all(int fd, const char* buf, size_t len, size_t chunk, uint64_t offset) {
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+    io_uring_cqe* cqes = static_cast<io_uring_cqe*>(cqes_);
+    last_error_ = 0;
+    remainders_.clear();
+
+    // Each SQE writes from pos to the end of pos's chunk, so a short
+    // completion's remainder is identified by its start position alone.
+    auto span_end = [len, chunk](size_t pos) { return std::min((pos / chunk + 1) * chunk, len); };
+    size_t next = 0;
+    while (last_error_ == 0 && (next < len || !remainders_.empty())) {
+        // Queue one batch of up to entries_ writes, remainders first.
+        unsigned batch = 0;
+        unsigned tail = *sq_tail_;
+        while (batch < entries_ && (next < len || !remainders_.empty())) {
+            size_t pos = next;
+            if (!remainders_.empty()) {
+                pos = remainders_.back();
+                remainders_.pop_back();
+            } else {
+                next = span_end(next);
+            }
+            unsigned index = tail & *sq_mask_;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(buf + pos);
+            sqe->len = static_cast<uint32_t>(span_end(pos) - pos);
+            sqe->off = offset + pos;
+            sqe->user_data = pos;
+            sq_array_[index] = index;
+            ++tail;
+            ++batch;
+        }
+        store_release(sq_tail_, tail);
+
+        unsigned submitted = submit_and_wait(batch);
+        if (submitted < batch) {
+            // The kernel takes SQEs in order and only inside io_uring_enter,
+            // so the rest can be withdrawn; left queued they would go out
+            // with the next call, pointing into a freed buf.
+            store_release(sq_tail_, tail - (batch - submitted));
+        }
+
+        // Reap everything submitted, even after a failure: until then the
+        // kernel may still read from buf.
+        unsigned reaped = 0;
+        while (reaped < submitted) {
+            unsigned head = *cq_head_;
+            if (head == load_acquire(cq_tail_)) {
+                wait_for_completion();
+                continue;
+            }
+            const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+            size_t pos = static_cast<size_t>(cqe.user_data);
+            if (cqe.res <= 0) {
+                // A zero-byte completion would resubmit forever; count it as EIO.
+                if (last_error_ == 0) {
+                    last_error_ = cqe.res < 0 ? cqe.res : -EIO;
+                }
+            } else if (pos + static_cast<size_t>(cqe.res) < span_end(pos)) {
+                remainders_.push_back(pos + static_cast<size_t>(cqe.res));
+            }
+            store_release(cq_head_, head + 1);
+            ++reaped;
+        }
+    }
+    return last_error_ == 0;
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,83 @@
+#ifndef HARNESS_URING_H_
+#define HARNESS_URING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mem_harness {
+
+/**
+ * @brief Minimal io_uring instance driven through the raw syscalls, so the
+ * harness does not need liburing. Only supports batched IORING_OP_WRITE.
+ *
+ * Not thread-safe; use one instance per thread.
+ */
+class Uring {
+ public:
+    Uring() = default;
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    /**
+     * @brief Sets up a ring with the given submission queue depth.
+     * @return false if io_uring is unavailable (old kernel, seccomp, ...).
+     */
+    bool init(unsigned entries);
+
+    /**
+     * @brief Writes len bytes from buf to fd at offset, keeping up to the
+     * ring depth of chunk-sized writes in flight. A short completion is
+     * resubmitted for its remainder. After the first failure no further
+     * chunks are queued.
+     *
+     * Returns only once every submitted write has completed, so the caller
+     * may free buf right after, even on failure.
+     * @return true if every chunk was written in full.
+     */
+    bool write_all(int fd, const char* buf, size_t len, size_t chunk, uint64_t offset = 0);
+
+    /**
+     * @brief -errno of the first failure in the last write_all(), or 0:
+     * a failed completion, -EIO for a write that completed with zero bytes,
+     * or a failed io_uring_enter. -EINVAL on a first write means the kernel
+     * predates IORING_OP_WRITE (5.6).
+     */
+    int last_error() const { return last_error_; }
+
+ private:
+    // Submits up to to_submit queued SQEs, waiting for as many
+    // completions. Returns how many the kernel took; on an error it records
+    // last_error_ and returns the count so far.
+    unsigned submit_and_wait(unsigned to_submit);
+    // Blocks until the completion queue is non-empty.
+    void wait_for_completion();
+
+    int ring_fd_ = -1;
+    unsigned entries_ = 0;
+    int last_error_ = 0;
+    // Start positions of short writes to resubmit; reserved to the ring
+    // depth in init(), which bounds it.
+    std::vector<size_t> remainders_;
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+};
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_URING_H_
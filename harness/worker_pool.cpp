@@ -0,0 +1,112 @@
+#include "harness/worker_pool.h"
+
+#include <future>
+#include <utility>
+
+#include "harness/heap_counters.h"
+
+namespace mem_harness {
+
+WorkerPool::WorkerPool(size_t num_workers) {
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+    for (size_t i = 0; i < num_workers; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers_.emplace_back(&WorkerPool::worker_loop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkerPool::post(std::function<void()> task) {
+    size_t index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        // Counted together with the push, under the queue mutex try_pop()
+        // decrements under: a worker woken by pending_ > 0 finds the task
+        // queued, and pending_ never underflows.
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+        pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        // A worker checks pending_ under wake_mutex_ before sleeping; taking
+        // it here orders the notify after that check, so none is lost.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+}
+
+void WorkerPool::run_and_wait(std::function<void()> task) {
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    post([&task, &done] {
+        task();
+        done.set_value();
+    });
+    finished.wait();
+}
+
+bool WorkerPool::try_pop(size_t index, std::function<void()>* task) {
+    // Own queue first (FIFO), then steal from the back of the others.
+    for (size_t offset = 0; offset < queues_.size(); ++offset) {
+        Queue& queue = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (offset == 0) {
+            *task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        } else {
+            *task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::worker_loop(size_t index) {
+    std::function<void()> task;
+    while (true) {
+        if (try_pop(index, &task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stopping_ || pending_.load(std::memory_order_relaxed) > 0;
+        });
+        if (stopping_ && pending_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+
+Stage pooled_stage(std::shared_ptr<WorkerPool> pool, std::function<void(int iteration)> task) {
+    return [pool = std::move(pool), task = std::move(task)](int iteration) {
+        HeapCounters delta;
+        pool->run_and_wait([&task, &delta, iteration] {
+            HeapCounters before = thread_heap_counters();
+            task(iteration);
+            delta = thread_heap_counters() - before;
+        });
+        absorb_heap_counters(delta);
+    };
+}
+
+}  // namespace mem_harness
@@ -0,0 +1,70 @@
+#ifndef HARNESS_WORKER_POOL_H_
+#define HARNESS_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "harness/harness.h"
+
+namespace mem_harness {
+
+/**
+ * @brief Fixed pool of long-lived worker threads with work stealing.
+ *
+ * Each worker owns a deque. post() distributes tasks round-robin; a worker
+ * pops from the front of its own deque and, when that is empty, steals from
+ * the back of the others before going to sleep.
+ */
+class WorkerPool {
+ public:
+    explicit WorkerPool(size_t num_workers);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Posts task and blocks until it has run.
+     */
+    void run_and_wait(std::function<void()> task);
+
+    size_t size() const { return queues_.size(); }
+
+ private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void worker_loop(size_t index);
+    bool try_pop(size_t index, std::function<void()>* task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{0};
+
+    // Sleep/wake bookkeeping; pending_ counts tasks not yet taken.
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_{0};
+    bool stopping_ = false;
+};
+
+/**
+ * @brief Wraps a task so that each iteration runs it on pool and waits for
+ * it, the pooled counterpart of spawn_thread_stage().
+ */
+Stage pooled_stage(std::shared_ptr<WorkerPool> pool, std::function<void(int iteration)> task);
+
+}  // namespace mem_harness
+
+#endif  // HARNESS_WORKER_POOL_H_
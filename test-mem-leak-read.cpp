@@ -1,191 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
-#include <vector>
-#include <thread>
-#include <chrono>
-#include <cstdlib>
-#include <unistd.h> // For getpid() - standard on POSIX systems
-#include <iomanip> // **FIX: Required for std::setprecision and std::fixed**
-
-#include <grpcpp/grpcpp.h>
-#include <grpcpp/security/credentials.h>
 
-// --- Configuration Constants ---
-
-// Total size of the temporary file (50 MB)
-constexpr size_t ARBITRARY_FILE_SIZE = 50 * 1024 * 1024;
-// The amount of data read by read_file (31 MB)
-constexpr size_t READ_SIZE =  30 * 1024 * 1024;
-// Number of iterations in the main loop
-constexpr int NUM_ITERATIONS = 50;
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "harness/channels.h"
+#include "harness/file_io.h"
+#include "harness/flags.h"
+#include "harness/harness.h"
+
+// --- Configuration ---
+
+ABSL_FLAG(int64_t, file_size_kb, 50 * 1024,
+          "Size of the temporary file, in KB; raised to the largest read size if smaller.");
+ABSL_FLAG(int64_t, read_size_kb, 30 * 1024, "Data read by read_file per iteration, in KB.");
+ABSL_FLAG(int32_t, iterations, 50, "Number of iterations in the main loop.");
+ABSL_FLAG(std::string, read_mode, "stream",
+          "How each iteration reads the file: 'stream' (ifstream into a heap "
+          "buffer) or 'mmap' (zero-copy MAP_POPULATE mapping).");
+ABSL_FLAG(bool, mmap_release, true,
+          "With --read_mode=mmap, MADV_DONTNEED the mapped pages at the end of each read "
+          "stage. Otherwise they stay resident in the mapping, which is kept for the run, "
+          "through the channel stage.");
+ABSL_FLAG(std::string, mock_file_mode, "write",
+          "How the mock file is generated: 'write' (zeros via ofstream), "
+          "'fallocate', 'sparse' (ftruncate) or 'copy' (copy_file_range from "
+          "a cached template).");
+ABSL_FLAG(bool, reuse_mock_file, false,
+          "Reuse an existing mock file of the right size, and keep it afterwards.");
 
 /**
- * @brief Helper function to return the current process Resident Set Size (RSS) in MB.
- *
- * This implementation is non-portable and targets Linux/POSIX environments
- * by reading the /proc/self/status file.
- * @return Current RSS in MB, or 0.0 if unable to read.
+ * @brief Runs the read-then-create-channel loop with the given buffer size.
+ * @return false if the leak check failed.
  */
-
- long get_current_rss_mb() {
-  // Default is getting memory usage for self (calling process)
-  std::string path = "/proc/self/stat";
-  std::ifstream stat_stream(path, std::ios_base::in);
-
-  double resident_set = 0.0;
-  // Temporary variables for irrelevant leading entries in stats
-  std::string temp_pid, comm, state, ppid, pgrp, session, tty_nr;
-  std::string tpgid, flags, minflt, cminflt, majflt, cmajflt;
-  std::string utime, stime, cutime, cstime, priority, nice;
-  std::string O, itrealvalue, starttime, vsize;
-
-  // Get rss to find memory usage
-  long rss;
-  stat_stream >> temp_pid >> comm >> state >> ppid >> pgrp >> session >>
-      tty_nr >> tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt >>
-      utime >> stime >> cutime >> cstime >> priority >> nice >> O >>
-      itrealvalue >> starttime >> vsize >> rss;
-  stat_stream.close();
-
-  // pid does not connect to an existing process
-  assert(!state.empty());
-
-  // Calculations in case x86-64 is configured to use 2MB pages
-  long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024;
-  resident_set = rss * page_size_kb;
-  // Memory in KB
-  return resident_set / 1024;
-}
-
-
-/**
- * @brief Reads a large chunk of data from the file into a temporary buffer.
- *
- * The buffer (data_buffer) is allocated on the stack/heap inside this function
- * and should be automatically released upon function exit.
- * @param file_path The path to the file to read.
- */
-void read_file(const std::string& file_path) {
-    // Open the file for reading in binary mode
-    std::ifstream file(file_path, std::ios::binary);
-
-    if (!file.is_open()) {
-        std::cerr << "Error: File '" << file_path << "' not found." << std::endl;
-        return;
+bool trigger_mem(const std::string& file_path, size_t read_size, bool quiet) {
+    mem_harness::HarnessOptions options;
+    options.num_iterations = absl::GetFlag(FLAGS_iterations);
+    options.pause = std::chrono::milliseconds(100);
+    mem_harness::apply_flags(&options);
+    options.quiet = quiet;
+
+    const bool use_mmap = absl::GetFlag(FLAGS_read_mode) == "mmap";
+    const bool mmap_release = absl::GetFlag(FLAGS_mmap_release);
+    mem_harness::MappedFile mapped;
+    if (use_mmap && !mapped.open(file_path, read_size)) {
+        return false;
     }
 
-    // Allocate a buffer on the heap using std::vector. This simulates the
-    // temporary memory consumption when reading the large file chunk.
-    // In Python, this is what f.read(READ_SIZE) does internally.
-    std::vector<char> data_buffer(READ_SIZE);
-
-    // Read the data into the buffer.
-    file.read(data_buffer.data(), READ_SIZE);
-
-    file.close();
-
-    // The data_buffer (and its underlying memory) is automatically released
-    // when the function exits (goes out of scope).
-}
-
-
-/**
- * @brief Simulates a task that involves repeated memory allocation and resource creation.
- * @param file_path The path to the file used for reading.
- */
-void trigger_mem(const std::string& file_path) {
-    double initial_rss = get_current_rss_mb();
-    std::cout << "PID: " << getpid() << std::endl;
-    std::cout << "Initial RSS: " << initial_rss << " MB" << std::endl;
-    std::cout << "---------------------------------------------------------" << std::endl;
-    double prev_rss = 0;
-
-    for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        // --- 1. File Read Simulation (Memory Spike) ---
-        // Create a thread to run the file read function.
-        std::thread t(read_file, file_path);
-        // read_file(file_path);
-
-        // Wait for the thread to finish. This ensures the memory allocated
-        // inside 'read_file' is released before the next iteration (unless a leak occurs).
-        t.join();
-
-        // --- 2. Resource Creation/Closing Simulation ---
-        // Create and immediately close a real gRPC channel.
-        std::string address = "localhost:" + std::to_string(4000 + i);
-        auto creds = grpc::InsecureChannelCredentials();
-        auto channel = grpc::CreateChannel(address, creds);
-        // channel goes out of scope here, and its destructor will handle cleanup.
-
-        // --- 3. Monitoring and Output ---
-        double current_rss = get_current_rss_mb();
-        double diff_from_start = current_rss - initial_rss;
-        double diff_from_last = current_rss - prev_rss;
-        prev_rss = current_rss;
-
-        std::cout << "Iteration " << std::noshowpos << i + 1 << "/" << NUM_ITERATIONS << ": "
-                  << "Current RSS: " << std::fixed << std::setprecision(2) << current_rss << " MB | "
-                  << "Total increase: " << std::showpos << std::fixed << std::setprecision(2) << diff_from_start << " MB";
-
-        if (diff_from_last != 0) {
-            std::cout << " | "
-                << "Delta: " << std::showpos << std::fixed << std::setprecision(2) << diff_from_last << " MB"
-                << std::endl;
-        } else {
-            std::cout << std::endl;
-        }
-
-        // Sleep to mimic real-world processing pause
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-}
-
-/**
- * @brief Mock function to create a large file for the test.
- * Note: This function is commented out in the Python code and replaced by a hardcoded path.
- * We implement it here for completeness, but the main logic still uses the hardcoded path.
- */
-void create_mock_file(const std::string& file_path, size_t size) {
-    std::cout << "Generating temporary file of size " << size / (1024.0 * 1024.0) << " MB..." << std::endl;
-    std::ofstream outfile(file_path, std::ios::binary);
-    if (!outfile.is_open()) {
-        std::cerr << "Error: Could not create mock file at " << file_path << std::endl;
-        return;
-    }
-
-    // Write null bytes (or random data) to simulate a large file.
-    std::vector<char> zero_chunk(1024 * 1024, '\0');
-    for (size_t written = 0; written < size; written += zero_chunk.size()) {
-        size_t write_size = std::min(zero_chunk.size(), size - written);
-        outfile.write(zero_chunk.data(), write_size);
+    mem_harness::Harness harness(options);
+    harness
+        .add_workload("read", mem_harness::io_stage([&file_path, &mapped, read_size, use_mmap,
+                                                     mmap_release](int) {
+            if (use_mmap) {
+                mapped.read(mmap_release);
+            } else {
+                mem_harness::read_file(file_path, read_size);
+            }
+        }))
+        .add_probe(mem_harness::io_throughput_probe())
+        // Separates allocator retention (anon) from page-cache mappings (file).
+        .add_probe(mem_harness::rss_breakdown_probe());
+    if (use_mmap) {
+        harness.add_probe(mem_harness::mapped_file_probe(&mapped));
     }
-    outfile.close();
-    std::cout << "Mock file created at: " << file_path << std::endl;
+    mem_harness::add_channel_stages(&harness);
+    harness.run();
+    return harness.passed();
 }
 
 int main(int argc, char* argv[]) {
-    // C++ doesn't use the Python logging module, but we can set up formatting
-    // for standard output (std::fixed and std::setprecision are for memory printing).
+    absl::ParseCommandLine(argc, argv);
+    mem_harness::apply_process_flags();
     std::cout << std::fixed << std::setprecision(2);
 
-    // The Python script used a hardcoded path, so we replicate that here.
-    // If you want to use the file generation, uncomment the block below.
     const std::string mock_file_path = "/tmp/tmp_mem_test_file";
 
-    // --- Mock File Creation (Only run this once if the file doesn't exist) ---
-    // If you comment this out, ensure the file '/tmp/tmp_mem_test_file' exists
-    // and is at least 31 MB large, or replace the path with an existing file.
-    create_mock_file(mock_file_path, ARBITRARY_FILE_SIZE);
-    
-    // --- Run the Memory Trigger Simulation ---
-    trigger_mem(mock_file_path);
+    const size_t read_size = static_cast<size_t>(absl::GetFlag(FLAGS_read_size_kb)) * 1024;
+    const mem_harness::SweepOptions sweep = mem_harness::sweep_options_from_flags();
+    size_t file_size = static_cast<size_t>(absl::GetFlag(FLAGS_file_size_kb)) * 1024;
+    file_size = std::max(file_size, absl::GetFlag(FLAGS_sweep) ? sweep.max_size : read_size);
+
+    // --- Mock File Creation ---
+    // The file must be at least as large as the largest read.
+    mem_harness::MockFileOptions mock_options;
+    const std::string mock_mode = absl::GetFlag(FLAGS_mock_file_mode);
+    if (mock_mode == "fallocate") {
+        mock_options.mode = mem_harness::MockFileMode::kFallocate;
+    } else if (mock_mode == "sparse") {
+        mock_options.mode = mem_harness::MockFileMode::kSparse;
+    } else if (mock_mode == "copy") {
+        mock_options.mode = mem_harness::MockFileMode::kCopy;
+    } else if (mock_mode != "write") {
+        std::cerr << "Warning: unknown --mock_file_mode '" << mock_mode << "', using write."
+                  << std::endl;
+    }
+    mock_options.reuse_existing = absl::GetFlag(FLAGS_reuse_mock_file);
+    if (!mem_harness::create_mock_file(mock_file_path, file_size, mock_options)) {
+        return 1;
+    }
+
+    bool ok = true;
+    if (!absl::GetFlag(FLAGS_channel_matrix).empty()) {
+        ok = mem_harness::run_channel_matrix_from_flags([&mock_file_path, read_size] {
+            return trigger_mem(mock_file_path, read_size, /*quiet=*/true);
+        });
+    } else if (absl::GetFlag(FLAGS_sweep)) {
+        ok = mem_harness::run_sweep(sweep, [&mock_file_path](size_t size, int) {
+            return trigger_mem(mock_file_path, size, /*quiet=*/true);
+        },
+        // Initialize gRPC before each point's baseline is taken.
+        [] { mem_harness::channel_churn()(0); });
+    } else {
+        // --- Run the Memory Trigger Simulation ---
+        ok = trigger_mem(mock_file_path, read_size, /*quiet=*/false);
+    }
 
-    // Clean up the mock file after the test
-    if (std::remove(mock_file_path.c_str()) != 0) {
+    // Clean up the mock file after the test, unless it is kept for reuse
+    if (!mock_options.reuse_existing && std::remove(mock_file_path.c_str()) != 0) {
         std::cerr << "Warning: Could not delete mock file." << std::endl;
     }
 
-    return 0;
+    return ok ? 0 : 1;
 }
@@ -1,174 +1,202 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
-#include <vector>
-#include <thread>
-#include <chrono>
-#include <cstdlib>
-#include <unistd.h> // For getpid() - standard on POSIX systems
-#include <iomanip> // **FIX: Required for std::setprecision and std::fixed**
 #include <sys/wait.h>
-#include <mutex>
-#include <atomic>
-#include <cassert>
-#include <dirent.h>
-#include <cctype>
-
-#include <grpcpp/grpcpp.h>
-#include <grpcpp/security/credentials.h>
-
-// --- Configuration Constants ---
-
-// The amount of data read by read_file (31 MB)
-constexpr size_t WRITE_SIZE =  30 * 1024 * 1024;
-// Number of iterations in the main loop
-constexpr int NUM_ITERATIONS = 500;
-constexpr int NUM_PROCESSES = 16;
-constexpr int NUM_THREADS_PER_PROCESS = 4;
-
-/**
- * @brief Helper function to return the current process Resident Set Size (RSS) in MB.
- *
- * This implementation is non-portable and targets Linux/POSIX environments
- * by reading the /proc/self/status file.
- * @return Current RSS in MB, or 0.0 if unable to read.
- */
-
-
- long get_current_rss_mb() {
-  // Default is getting memory usage for self (calling process)
-  std::string path = "/proc/self/stat";
-  std::ifstream stat_stream(path, std::ios_base::in);
-
-  double resident_set = 0.0;
-  // Temporary variables for irrelevant leading entries in stats
-  std::string temp_pid, comm, state, ppid, pgrp, session, tty_nr;
-  std::string tpgid, flags, minflt, cminflt, majflt, cmajflt;
-  std::string utime, stime, cutime, cstime, priority, nice;
-  std::string O, itrealvalue, starttime, vsize;
-
-  // Get rss to find memory usage
-  long rss;
-  stat_stream >> temp_pid >> comm >> state >> ppid >> pgrp >> session >>
-      tty_nr >> tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt >>
-      utime >> stime >> cutime >> cstime >> priority >> nice >> O >>
-      itrealvalue >> starttime >> vsize >> rss;
-  stat_stream.close();
-
-  // pid does not connect to an existing process
-  assert(!state.empty());
-
-  // Calculations in case x86-64 is configured to use 2MB pages
-  long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024;
-  resident_set = rss * page_size_kb;
-  // Memory in KB
-  return resident_set / 1024;
-}
-
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include <grpc/grpc.h>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "harness/aggregate.h"
+#include "harness/channels.h"
+#include "harness/file_io.h"
+#include "harness/flags.h"
+#include "harness/harness.h"
+#include "harness/results.h"
+#include "harness/rss.h"
+#include "harness/sampler.h"
+
+// --- Configuration ---
+
+ABSL_FLAG(int64_t, write_size_kb, 30 * 1024, "Data written by write_file per iteration, in KB.");
+ABSL_FLAG(int32_t, iterations, 500, "Number of iterations in each thread's loop.");
+ABSL_FLAG(int32_t, processes, 16, "Number of forked child processes.");
+ABSL_FLAG(int32_t, threads_per_process, 4, "Number of looping threads per child process.");
+ABSL_FLAG(std::string, fork_mode, "postfork",
+          "When gRPC is initialized: 'postfork' (each child on its first channel) or "
+          "'prefork' (once in the parent with GRPC_ENABLE_FORK_SUPPORT, shared "
+          "copy-on-write by the children).");
 
 /**
- * @brief Writes a large chunk of data to the file from a temporary buffer.
- *
- * The buffer (data_buffer) is allocated on the stack/heap inside this function
- * and should be automatically released upon function exit.
- * @param file_path The path to the file to write.
+ * @brief One looping thread's harness run.
+ * @return false if its leak check failed.
  */
-void write_file(const std::string& file_path) {
-    // Open the file for writing in binary mode, truncating if it exists
-    std::ofstream file(file_path, std::ios::binary | std::ios::out | std::ios::trunc);
-
-    if (!file.is_open()) {
-        // std::cerr << "Error: File '" << file_path << "' not found." << std::endl;
-        return;
+bool thread_task(int thread_id, size_t write_size, bool quiet,
+                 mem_harness::ChildSlots* slots = nullptr, int child = -1) {
+    if (child >= 0) {
+        mem_harness::apply_placement(child, thread_id, absl::GetFlag(FLAGS_threads_per_process));
     }
 
-    // Allocate a buffer on the heap using std::vector. This simulates the
-    // temporary memory consumption when reading the large file chunk.
-    // In Python, this is what f.read(WRITE_SIZE) does internally.
-    std::vector<char> data_buffer(WRITE_SIZE);
-
-    // Write the data from the buffer.
-    file.write(data_buffer.data(), WRITE_SIZE);
-
-    file.close();
-
-    // The data_buffer (and its underlying memory) is automatically released
-    // when the function exits (goes out of scope).
-}
-
-std::mutex print_mutex;
-
-void thread_task(int thread_id) {
-    double initial_rss = get_current_rss_mb();
-
     // Unique file path per thread to avoid collision
     std::stringstream ss;
     ss << "/tmp/test_file_" << getpid() << "_" << std::this_thread::get_id() << ".txt";
-    std::string file_path = ss.str();
-
-    for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        // --- 1. File Read Simulation (Memory Spike) ---
-        // Delete the file before writing
-        if (std::remove(file_path.c_str()) != 0) {
-            // perror("remove"); // Optional: Okay if file doesn't exist
-        }
-        // Offload the file writing to a separate thread
-        std::thread t(write_file, file_path);
-        
-        // Wait for the thread to finish. This ensures the memory allocated
-        // inside 'write_file' is released before the next iteration (unless a leak occurs).
-        t.join();
+    const std::string file_path = ss.str();
+
+    std::stringstream label;
+    label << "PID: " << getpid() << " TID: " << thread_id << " ";
+
+    mem_harness::HarnessOptions options;
+    options.num_iterations = absl::GetFlag(FLAGS_iterations);
+    options.label = label.str();
+    options.print_banner = false;
+    mem_harness::apply_flags(&options);
+    options.quiet = quiet;
+    // The heap profile is process-wide; one diff per process is enough.
+    if (thread_id != 0) {
+        options.heap_profile_top = 0;
+    }
 
-        // --- 2. Resource Creation/Closing Simulation (gRPC lines commented out) ---
-        // The following lines are commented out to isolate the memory usage
-        // of the threading pattern from the gRPC channel creation.
-        std::string address = "localhost:" + std::to_string(4000 + i);
-        auto creds = grpc::InsecureChannelCredentials();
-        auto channel = grpc::CreateChannel(address, creds);
-        // channel goes out of scope here, and its destructor will handle cleanup.
-
-        // --- 3. Monitoring and Output ---
-        double current_rss = get_current_rss_mb();
-        double diff_from_start = current_rss - initial_rss;
-
-        {
-            std::lock_guard<std::mutex> lock(print_mutex);
-            std::cout << "PID: " << getpid() << " TID: " << thread_id 
-                      << " Iteration " << i + 1 << "/" << NUM_ITERATIONS << ": "
-                      << "Current RSS: " << std::fixed << std::setprecision(2) << current_rss << " MB | "
-                      << "Total increase: +" << std::fixed << std::setprecision(2) << diff_from_start << " MB"
-                      << std::endl;
-        }
-        
+    mem_harness::Harness harness(options);
+    harness
+        .add_workload("write", mem_harness::io_stage([&file_path, write_size](int) {
+            // Delete the file before writing; okay if it doesn't exist.
+            std::remove(file_path.c_str());
+            mem_harness::write_file(file_path, write_size);
+        }))
+        .add_probe(mem_harness::io_throughput_probe());
+    mem_harness::add_channel_stages(&harness);
+    harness.run();
+    if (slots != nullptr) {
+        slots->publish(child, harness.rss_series(), harness.iterations_run());
     }
+
     // Cleanup
     std::remove(file_path.c_str());
+    return harness.passed();
 }
 
-void process_task() {
+/**
+ * @brief Runs the child's threads, recording its footprint once its first
+ * channel exists (gRPC initialized) and again after the threads finished.
+ * @param fork_ns now_ns() in the parent just before this child was forked.
+ * @return false if any thread's leak check failed.
+ */
+bool process_task(mem_harness::ChildSlots* slots, int child, int64_t fork_ns) {
+    if (slots != nullptr) {
+        slots->attach(child, getpid());
+    }
+    mem_harness::channel_churn()(0);
+    if (slots != nullptr) {
+        mem_harness::ChildFootprint startup = mem_harness::measure_footprint();
+        startup.startup_ms = (mem_harness::now_ns() - fork_ns) / 1e6;
+        slots->publish_startup(child, startup);
+    }
+    const size_t write_size = static_cast<size_t>(absl::GetFlag(FLAGS_write_size_kb)) * 1024;
+    std::atomic<bool> passed{true};
     std::vector<std::thread> threads;
-    for (int i = 0; i < NUM_THREADS_PER_PROCESS; ++i) {
-        threads.emplace_back(thread_task, i);
+    for (int i = 0; i < absl::GetFlag(FLAGS_threads_per_process); ++i) {
+        threads.emplace_back([&passed, i, write_size, slots, child] {
+            if (!thread_task(i, write_size, /*quiet=*/false, slots, child)) {
+                passed = false;
+            }
+        });
     }
     for (auto& t : threads) {
         t.join();
     }
+    if (slots != nullptr) {
+        slots->publish_exit(child, mem_harness::measure_footprint());
+    }
+    return passed;
 }
 
 int main(int argc, char* argv[]) {
-    // C++ doesn't use the Python logging module, but we can set up formatting
-    // for standard output (std::fixed and std::setprecision are for memory printing).
+    absl::ParseCommandLine(argc, argv);
+    std::string fork_mode = absl::GetFlag(FLAGS_fork_mode);
+    if (fork_mode != "postfork" && fork_mode != "prefork") {
+        std::cerr << "Warning: unknown --fork_mode '" << fork_mode << "', using postfork."
+                  << std::endl;
+        fork_mode = "postfork";
+    }
+    if (fork_mode == "prefork") {
+        // Read by grpc_init(); installs the atfork handlers that quiesce and
+        // restart gRPC's threads around fork().
+        setenv("GRPC_ENABLE_FORK_SUPPORT", "1", 1);
+    }
+    mem_harness::apply_process_flags();
     std::cout << std::fixed << std::setprecision(2);
 
+    if (!absl::GetFlag(FLAGS_channel_matrix).empty()) {
+        // Each profile is one child process running --threads_per_process threads.
+        bool ok = mem_harness::run_channel_matrix_from_flags([] {
+            const size_t write_size =
+                static_cast<size_t>(absl::GetFlag(FLAGS_write_size_kb)) * 1024;
+            std::atomic<bool> passed{true};
+            std::vector<std::thread> threads;
+            for (int i = 0; i < absl::GetFlag(FLAGS_threads_per_process); ++i) {
+                threads.emplace_back([&passed, i, write_size] {
+                    if (!thread_task(i, write_size, /*quiet=*/true)) {
+                        passed = false;
+                    }
+                });
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            return passed.load();
+        });
+        return ok ? 0 : 1;
+    }
+
+    if (absl::GetFlag(FLAGS_sweep)) {
+        // Each sweep point is one child process running 1..N threads.
+        bool ok = mem_harness::run_sweep(mem_harness::sweep_options_from_flags(),
+                                         [](size_t size, int thread_index) {
+                                             return thread_task(thread_index, size,
+                                                                /*quiet=*/true);
+                                         },
+                                         // Initialize gRPC before each point's baseline.
+                                         [] { mem_harness::channel_churn()(0); });
+        return ok ? 0 : 1;
+    }
+
+    // Mapped before forking so children report their RSS series to the
+    // parent; sized like the series of the children's harnesses, which a
+    // soak samples once per report interval.
+    mem_harness::HarnessOptions child_options;
+    child_options.num_iterations = absl::GetFlag(FLAGS_iterations);
+    mem_harness::apply_flags(&child_options);
+    std::unique_ptr<mem_harness::ChildSlots> slots = mem_harness::ChildSlots::create(
+        absl::GetFlag(FLAGS_processes),
+        static_cast<int>(mem_harness::series_capacity(child_options)),
+        mem_harness::series_interval(child_options).count());
+
+    // A channel alone would not do: destroying it drops gRPC's init count
+    // to zero and gRPC shuts down again before the fork. The parent holds
+    // its own reference until every child has exited.
+    const bool prefork = fork_mode == "prefork";
+    if (prefork) {
+        grpc_init();
+        mem_harness::channel_churn()(0);
+    }
+    const long parent_rss_kb = mem_harness::get_current_rss_kb();
+
     std::vector<pid_t> pids;
-    for (int i = 0; i < NUM_PROCESSES; ++i) {
+    for (int i = 0; i < absl::GetFlag(FLAGS_processes); ++i) {
+        const int64_t fork_ns = mem_harness::now_ns();
         pid_t pid = fork();
         if (pid == 0) {
             // Child process
-            process_task();
-            return 0;
+            return process_task(slots.get(), i, fork_ns) ? 0 : 1;
         } else if (pid > 0) {
             pids.push_back(pid);
         } else {
@@ -177,10 +205,25 @@ int main(int argc, char* argv[]) {
     }
 
     // Wait for all child processes
+    bool passed = true;
     for (pid_t pid : pids) {
         int status;
         waitpid(pid, &status, 0);
+        if (WIFSIGNALED(status)) {
+            // SIGKILL here is usually the OOM killer under --cgroup_memory_max_mb.
+            std::cerr << "Child " << pid << " killed by signal " << WTERMSIG(status) << std::endl;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            passed = false;
+        }
+    }
+    if (prefork) {
+        grpc_shutdown();
+    }
+    if (slots && !mem_harness::results_to_stdout()) {
+        slots->report(absl::GetFlag(FLAGS_leak_warmup_iterations));
+        slots->report_footprints(fork_mode, parent_rss_kb);
     }
 
-    return 0;
+    return passed ? 0 : 1;
 }